@@ -7,6 +7,11 @@
 TEMPLATE = subdirs
 
 SUBDIRS += src \
+        bench \
+        benchgui \
         askelib_qt
 
 src.depends = askelib_qt
+bench.depends = askelib_qt
+benchgui.file = bench/gui/gui.pro
+benchgui.depends = askelib_qt
@@ -0,0 +1,64 @@
+#include "bench.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cmath>
+
+namespace cashbook
+{
+
+namespace bench
+{
+
+qint64 sink {0};
+
+qint64 Samples::median() const
+{
+    return percentile(50);
+}
+
+qint64 Samples::percentile(int percent) const
+{
+    if(m_values.empty()) {
+        return 0;
+    }
+
+    std::vector<qint64> sorted {m_values};
+    std::sort(sorted.begin(), sorted.end());
+
+    const double rank {std::ceil(percent / 100.0 * static_cast<double>(sorted.size()))};
+    const size_t index {static_cast<size_t>(std::max(rank, 1.0)) - 1};
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void report(QTextStream &out, const QString &name, const Samples &samples)
+{
+    const auto ms = [](qint64 nsecs) {
+        return QString::number(static_cast<double>(nsecs) / 1e6, 'f', 3);
+    };
+
+    out << qSetFieldWidth(26) << Qt::left << name << qSetFieldWidth(0)
+        << "median " << qSetFieldWidth(10) << Qt::right << ms(samples.median()) << qSetFieldWidth(0) << " ms"
+        << "   p95 " << qSetFieldWidth(10) << ms(samples.percentile(95)) << qSetFieldWidth(0) << " ms"
+        << Qt::endl;
+}
+
+bool copyData(const QString &from, const QString &to)
+{
+    if(!QDir().mkpath(to)) {
+        return false;
+    }
+
+    for(const QFileInfo &file : QDir(from).entryInfoList(QDir::Files)) {
+        if(!QFile::copy(file.filePath(), QDir(to).filePath(file.fileName()))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace bench
+
+} // namespace cashbook
@@ -0,0 +1,156 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <QDate>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextStream>
+
+#include <functional>
+#include <vector>
+
+namespace cashbook
+{
+
+class Data;
+
+namespace bench
+{
+
+/**
+ * @brief Durations of repeated runs of a single benchmark, in nanoseconds.
+ */
+class Samples
+{
+public:
+    void add(qint64 nsecs) {
+        m_values.push_back(nsecs);
+    }
+
+    bool isEmpty() const {
+        return m_values.empty();
+    }
+
+    qint64 median() const;
+    qint64 percentile(int percent) const; // nearest-rank
+
+private:
+    std::vector<qint64> m_values;
+};
+
+/**
+ * Benchmarks accumulate results here to keep the compiler from throwing
+ * the work away.
+ */
+extern qint64 sink;
+
+template <class Func>
+qint64 elapsed(Func func)
+{
+    QElapsedTimer timer;
+    timer.start();
+    func();
+    return timer.nsecsElapsed();
+}
+
+void report(QTextStream &out, const QString &name, const Samples &samples);
+
+/**
+ * @brief Makes a directory current for its lifetime.
+ * @details Storage paths are relative to the current directory, so `load()`
+ *          and `save()` work on `data` directory of the current one.
+ */
+class CurrentDir
+{
+public:
+    explicit CurrentDir(const QString &path)
+        : m_previous(QDir::currentPath())
+    {
+        QDir::setCurrent(path);
+    }
+
+    ~CurrentDir() {
+        QDir::setCurrent(m_previous);
+    }
+
+private:
+    QString m_previous;
+};
+
+/**
+ * Copies files of a data directory. Backups are not copied.
+ */
+bool copyData(const QString &from, const QString &to);
+
+struct GeneratorOptions
+{
+    int years {3};
+    int perDay {5};
+    int depth {3};             // of categories trees
+    int fanout {4};            // of categories and wallets trees
+    int wallets {10};
+    double archived {0.05};    // ratio of references to removed wallets and categories
+    double transferDays {0.1}; // ratio of days with chains of transfers
+    quint64 seed {1};
+    QDate end {2024, 12, 31};  // newest day of the log, fixed so data does not depend on the day of the run
+};
+
+/**
+ * Compares storage codecs against Qt parsing they replaced.
+ */
+int runCodecs(QTextStream &out);
+
+/**
+ * Times load, save, normalization, task update and category aggregation
+ * over a copy of `dataDir`.
+ */
+int runPhases(QTextStream &out, const QString &dataDir, int iterations);
+
+/**
+ * Fills `data` with synthetic wallets, categories, log and tasks.
+ */
+void generate(Data &data, const GeneratorOptions &options);
+
+/**
+ * Writes synthetic data directory and checks that it round-trips.
+ */
+int runGenerate(QTextStream &out, const QString &dataDir, const GeneratorOptions &options);
+
+/**
+ * Loads data directory, saves it back and compares saved files with original ones.
+ */
+int runVerify(QTextStream &out, const QString &dataDir);
+
+/**
+ * @brief Named benchmark over a generated data set.
+ * @details `prepare` restores data before every run and is not timed.
+ */
+struct Benchmark
+{
+    QString name;
+    std::function<void(Data &)> prepare;
+    std::function<void(Data &)> run;
+};
+
+#ifdef CASHBOOK_BENCH_GUI
+/**
+ * Benchmarks of treemap and popup tree models over `data`. `restore` brings
+ * the log back to generated state.
+ */
+std::vector<Benchmark> guiBenchmarks(Data &data, const std::function<void(Data &)> &restore);
+#endif
+
+/**
+ * Times bookkeeping hot paths on generated data of increasing size. If
+ * `baselineFile` is given, results are either written to it or compared
+ * with it, and a benchmark which is slower than baseline by more than
+ * `threshold` fails the run.
+ */
+int runMicro(QTextStream &out, int iterations, const QString &baselineFile, bool writeBaseline, double threshold);
+
+} // namespace bench
+
+} // namespace cashbook
+
+#endif // BENCH_H
@@ -0,0 +1,61 @@
+#-------------------------------------------------
+#
+# Sources and settings shared by benchmark targets
+#
+#-------------------------------------------------
+
+QT += core concurrent
+
+TEMPLATE = app
+
+CONFIG += console c++latest
+CONFIG -= app_bundle
+
+include( $$PWD/../askelib_qt/public.pri )
+include( $$PWD/../askelib_qt/askelib/public.pri )
+
+INCLUDEPATH += $$PWD/..
+INCLUDEPATH += $$PWD/../src
+INCLUDEPATH += $$PWD/../askelib_qt
+INCLUDEPATH += $$PWD/../third-party/yaml-cpp/include
+INCLUDEPATH += $$PWD/../third-party/
+INCLUDEPATH += $$PWD
+
+LIBS += -L$${ASKELIBQT_LIB_PATH} -laskelib_qt_std$${ASKELIBQT_LIB_SUFFIX}
+LIBS += -L$${ASKELIB_LIB_PATH} -laskelib_std$${ASKELIB_LIB_SUFFIX}
+
+# bookkeeping layer without models and widgets
+HEADERS += \
+    $$PWD/bench.h \
+    $$PWD/../src/bookkeeping/basic_types.h \
+    $$PWD/../src/bookkeeping/bookkeeping.h \
+    $$PWD/../src/bookkeeping/codecs.h \
+    $$PWD/../src/bookkeeping/cache.h \
+    $$PWD/../src/bookkeeping/serialization.h \
+    $$PWD/../src/bookkeeping/segment.h \
+    $$PWD/../src/bookkeeping/trace.h \
+    $$files($$PWD/../third-party/yaml-cpp/src/*.h) \
+    $$PWD/../third-party/qtyaml.h
+
+SOURCES += \
+    $$PWD/main.cpp \
+    $$PWD/bench.cpp \
+    $$PWD/codecsbench.cpp \
+    $$PWD/generator.cpp \
+    $$PWD/micro.cpp \
+    $$PWD/phases.cpp \
+    $$PWD/../src/bookkeeping/basic_types.cpp \
+    $$PWD/../src/bookkeeping/bookkeeping.cpp \
+    $$PWD/../src/bookkeeping/codecs.cpp \
+    $$PWD/../src/bookkeeping/cache.cpp \
+    $$PWD/../src/bookkeeping/serialization.cpp \
+    $$PWD/../src/bookkeeping/segment.cpp \
+    $$PWD/../src/bookkeeping/trace.cpp \
+    $$files($$PWD/../third-party/yaml-cpp/src/*.cpp)
+
+win32-msvc* {
+    QMAKE_CXXFLAGS_RELEASE += /O2
+}
+win32-g++ {
+    QMAKE_CXXFLAGS_RELEASE += -Ofast
+}
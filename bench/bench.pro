@@ -0,0 +1,11 @@
+#-------------------------------------------------
+#
+# Headless benchmarks of storage and bookkeeping
+#
+#-------------------------------------------------
+
+include( bench.pri )
+
+QT -= gui
+
+TARGET = cashbook-bench
@@ -0,0 +1,95 @@
+#include "bench.h"
+#include "bookkeeping/codecs.h"
+
+#include <QUuid>
+
+#include <string>
+#include <vector>
+
+namespace cashbook
+{
+
+namespace bench
+{
+
+static constexpr int Inputs {1 << 12};
+static constexpr int Rounds {64};
+
+/**
+ * Runs `func` over every input `Rounds` times and returns nanoseconds per call.
+ */
+template <class Func>
+static double nsPerOp(Func func)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    for(int r = 0; r<Rounds; ++r) {
+        for(int i = 0; i<Inputs; ++i) {
+            func(i);
+        }
+    }
+
+    return static_cast<double>(timer.nsecsElapsed()) / (static_cast<double>(Rounds) * Inputs);
+}
+
+/**
+ * Enum parsing as it was done before codecs: a chain of string compares.
+ */
+static Transaction::Type::t legacyTransactionType(const QString &str)
+{
+    if(str == QLatin1String("In")) return Transaction::Type::In;
+    if(str == QLatin1String("Out")) return Transaction::Type::Out;
+    if(str == QLatin1String("Transfer")) return Transaction::Type::Transfer;
+    return Transaction::Type::Out;
+}
+
+static void reportRatio(QTextStream &out, const char *name, double legacy, double codec)
+{
+    out << qSetFieldWidth(8) << Qt::left << name << qSetFieldWidth(0)
+        << "legacy " << qSetFieldWidth(9) << Qt::right << QString::number(legacy, 'f', 1) << qSetFieldWidth(0) << " ns"
+        << "   codec " << qSetFieldWidth(9) << QString::number(codec, 'f', 1) << qSetFieldWidth(0) << " ns"
+        << "   x" << QString::number(legacy / codec, 'f', 1) << Qt::endl;
+}
+
+int runCodecs(QTextStream &out)
+{
+    std::vector<std::string> dates;
+    std::vector<std::string> uuids;
+    std::vector<std::string> amounts;
+    std::vector<std::string> types;
+
+    const QDate first(2015, 1, 1);
+    for(int i = 0; i<Inputs; ++i) {
+        dates.push_back(codecs::formatDate(first.addDays(i % 3000)));
+        uuids.push_back(codecs::formatUuid(QUuid::createUuid()));
+        amounts.push_back(std::to_string((static_cast<qint64>(i) * 7919) % 10000000));
+        types.push_back(std::string(codecs::transactionTypes.name(static_cast<Transaction::Type::t>(i % Transaction::Type::Count))));
+    }
+
+    // accumulated to keep the compiler from throwing the work away
+    qint64 sink = 0;
+
+    reportRatio(out, "date",
+        nsPerOp([&](int i) { sink += QDate::fromString(QString::fromStdString(dates[i]), QStringLiteral("dd.MM.yyyy")).day(); }),
+        nsPerOp([&](int i) { sink += codecs::parseDate(dates[i]).day(); }));
+
+    reportRatio(out, "uuid",
+        nsPerOp([&](int i) { sink += QUuid(QString::fromStdString(uuids[i])).data1; }),
+        nsPerOp([&](int i) { sink += codecs::parseUuid(uuids[i]).data1; }));
+
+    reportRatio(out, "amount",
+        nsPerOp([&](int i) { sink += QString::fromStdString(amounts[i]).toInt(); }),
+        nsPerOp([&](int i) { qint64 cents = 0; codecs::parseCents(amounts[i], cents); sink += cents; }));
+
+    reportRatio(out, "type",
+        nsPerOp([&](int i) { sink += legacyTransactionType(QString::fromStdString(types[i])); }),
+        nsPerOp([&](int i) { sink += codecs::transactionTypes.fromName(types[i]); }));
+
+    out << "checksum " << sink << Qt::endl;
+    return 0;
+}
+
+} // namespace bench
+
+} // namespace cashbook
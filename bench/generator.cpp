@@ -0,0 +1,318 @@
+#include "bench.h"
+#include "bookkeeping/bookkeeping.h"
+#include "bookkeeping/serialization.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <random>
+
+namespace cashbook
+{
+
+namespace bench
+{
+
+static const QStringList notes {
+    QStringLiteral("продукты"),
+    QStringLiteral("обед"),
+    QStringLiteral("такси"),
+    QStringLiteral("подарок"),
+};
+
+/**
+ * @brief Random data of the generator. Same seed gives the same data.
+ */
+class Generator
+{
+public:
+    Generator(Data &data, const GeneratorOptions &options)
+        : m_data(data)
+        , m_options(options)
+        , m_random(options.seed)
+    {}
+
+    void generate()
+    {
+        m_data.clear();
+
+        generateOwners();
+        generateWallets();
+        generateCategories(m_data.inCategories, QStringLiteral("Доход"), m_inLeaves);
+        generateCategories(m_data.outCategories, QStringLiteral("Расход"), m_outLeaves);
+        generateLog();
+        generateTasks();
+    }
+
+private:
+    bool chance(double probability) {
+        return std::bernoulli_distribution(probability)(m_random);
+    }
+
+    int number(int from, int to) {
+        return std::uniform_int_distribution<int>(from, to)(m_random);
+    }
+
+    template <class T>
+    const T &pick(const std::vector<T> &items) {
+        return items[static_cast<size_t>(number(0, static_cast<int>(items.size()) - 1))];
+    }
+
+    void generateOwners()
+    {
+        m_data.owners.owners = {Owner(QStringLiteral("Владелец 1")), Owner(QStringLiteral("Владелец 2"))};
+        m_data.owners.rebuildIndex();
+        m_data.banks.banks = {Bank(QStringLiteral("Банк 1")), Bank(QStringLiteral("Банк 2"))};
+        m_data.banks.rebuildIndex();
+    }
+
+    void generateWallets()
+    {
+        const int fanout {std::max(m_options.fanout, 1)};
+
+        Node<Wallet> *group {nullptr};
+        for(int i = 0; i<m_options.wallets; ++i) {
+            if(i % fanout == 0) {
+                Wallet wallet;
+                wallet.name = QStringLiteral("Группа %1").arg(i / fanout + 1);
+                wallet.info->owner = &m_data.owners.owners[0];
+                group = m_data.wallets.rootItem->addChild(wallet);
+            }
+
+            Wallet wallet;
+            wallet.name = QStringLiteral("Кошелёк %1").arg(i + 1);
+            wallet.amount = Money(static_cast<intmax_t>(number(0, 10000000)));
+
+            if(i % 2) {
+                auto info = std::make_shared<Wallet::CardInfo>();
+                info->bank = &m_data.banks.banks[static_cast<qsizetype>(i % m_data.banks.banks.size())];
+                wallet.type = Wallet::Type::Card;
+                wallet.info = std::move(info);
+            } else {
+                wallet.type = Wallet::Type::Cash;
+                wallet.info = std::make_shared<Wallet::CashInfo>();
+            }
+            wallet.info->owner = &m_data.owners.owners[static_cast<qsizetype>(i % m_data.owners.owners.size())];
+
+            m_wallets.push_back(group->addChild(wallet));
+        }
+
+        m_data.wallets.rebuildIndex();
+    }
+
+    void generateCategories(Node<Category> *node, const QString &name, int depth, std::vector<const Node<Category> *> &leaves)
+    {
+        if(depth == 0) {
+            leaves.push_back(node);
+            return;
+        }
+
+        for(int i = 0; i<m_options.fanout; ++i) {
+            Category category(QStringLiteral("%1.%2").arg(name).arg(i + 1));
+            category.regular = chance(0.2);
+            generateCategories(node->addChild(category), category, depth - 1, leaves);
+        }
+    }
+
+    void generateCategories(CategoriesData &data, const QString &name, std::vector<const Node<Category> *> &leaves)
+    {
+        generateCategories(data.rootItem, name, std::max(m_options.depth, 1), leaves);
+        data.rebuildIndex();
+    }
+
+    template <class T>
+    ArchNode<T> reference(const std::vector<const Node<T> *> &nodes, const QString &archiveName)
+    {
+        ArchNode<T> res;
+        if(chance(m_options.archived)) {
+            res = ArchiveString(QStringLiteral("%1 %2").arg(archiveName).arg(number(1, 10)));
+        } else {
+            res = pick(nodes);
+        }
+        return res;
+    }
+
+    Money amount() {
+        return Money(static_cast<intmax_t>(number(100, 500000)));
+    }
+
+    void generateLog()
+    {
+        const QDate first {m_options.end.addYears(-std::max(m_options.years, 1))};
+
+        // log is sorted newest first
+        for(QDate date = m_options.end; date > first; date = date.addDays(-1)) {
+            for(int i = 0; i<m_options.perDay; ++i) {
+                Transaction t;
+                t.date = date;
+                t.amount = amount();
+
+                const int kind {number(0, 9)};
+                if(kind == 0) {
+                    t.type = Transaction::Type::In;
+                    t.category = reference(m_inLeaves, QStringLiteral("Старый доход"));
+                    t.to = reference(m_wallets, QStringLiteral("Старый кошелёк"));
+                } else if(kind == 1) {
+                    t.type = Transaction::Type::Transfer;
+                    t.from = reference(m_wallets, QStringLiteral("Старый кошелёк"));
+                    t.to = reference(m_wallets, QStringLiteral("Старый кошелёк"));
+                } else {
+                    t.type = Transaction::Type::Out;
+                    t.category = reference(m_outLeaves, QStringLiteral("Старый расход"));
+                    t.from = reference(m_wallets, QStringLiteral("Старый кошелёк"));
+                }
+
+                if(chance(0.3)) {
+                    t.note = notes[number(0, static_cast<int>(notes.size()) - 1)];
+                }
+
+                m_data.log.log.push_back(std::move(t));
+            }
+
+            // chains like A->B->C of the same amount, which normalization turns into A->C
+            if(m_wallets.size() >= 3 && chance(m_options.transferDays)) {
+                const int chains {number(1, 3)};
+                for(int c = 0; c<chains; ++c) {
+                    const Money money {amount()};
+                    const int length {number(2, 4)};
+
+                    const Node<Wallet> *from {pick(m_wallets)};
+                    for(int i = 0; i<length; ++i) {
+                        const Node<Wallet> *to {pick(m_wallets)};
+
+                        Transaction t;
+                        t.date = date;
+                        t.type = Transaction::Type::Transfer;
+                        t.amount = money;
+                        t.from = from;
+                        t.to = to;
+                        m_data.log.log.push_back(std::move(t));
+
+                        from = to;
+                    }
+                }
+            }
+
+            m_data.log.markMonthChanged(Month(date));
+        }
+
+        m_data.log.invalidateIndices();
+        m_data.log.invalidateTotals();
+    }
+
+    void generateTasks()
+    {
+        if(m_outLeaves.empty()) {
+            return;
+        }
+
+        const QDate lastMonth {m_options.end.year(), m_options.end.month(), 1};
+
+        for(int i = 0; i<3; ++i) {
+            // tasks on upper level categories, so they sum many leaves
+            const Node<Category> *category {pick(m_outLeaves)};
+            while(category->parent && category->parent->parent) {
+                category = category->parent;
+            }
+
+            Task task;
+            task.type = Transaction::Type::Out;
+            task.category = category;
+            task.from = lastMonth.addMonths(-i * 3);
+            task.to = task.from.addMonths(3).addDays(-1);
+            task.amount = Money(static_cast<intmax_t>(10000000));
+            m_data.tasks.active.tasks.push_back(task);
+        }
+    }
+
+    Data &m_data;
+    const GeneratorOptions &m_options;
+    std::mt19937_64 m_random;
+
+    std::vector<const Node<Wallet> *> m_wallets;
+    std::vector<const Node<Category> *> m_inLeaves;
+    std::vector<const Node<Category> *> m_outLeaves;
+};
+
+void generate(Data &data, const GeneratorOptions &options)
+{
+    Generator(data, options).generate();
+}
+
+int runGenerate(QTextStream &out, const QString &dataDir, const GeneratorOptions &options)
+{
+    QTemporaryDir workDir;
+    if(!workDir.isValid()) {
+        out << "can not create temporary directory" << Qt::endl;
+        return 1;
+    }
+
+    size_t rows {0};
+    {
+        CurrentDir current(workDir.path());
+
+        Data data;
+        generate(data, options);
+        rows = data.log.log.size();
+        save(data);
+    }
+
+    if(!copyData(workDir.filePath(QStringLiteral("data")), dataDir)) {
+        out << "can not write " << dataDir << Qt::endl;
+        return 1;
+    }
+
+    out << dataDir << ": " << rows << " transactions generated" << Qt::endl;
+    return runVerify(out, dataDir);
+}
+
+int runVerify(QTextStream &out, const QString &dataDir)
+{
+    QTemporaryDir workDir;
+    if(!workDir.isValid()) {
+        out << "can not create temporary directory" << Qt::endl;
+        return 1;
+    }
+
+    const QString copyDir {workDir.filePath(QStringLiteral("data"))};
+    if(!copyData(dataDir, copyDir)) {
+        out << "can not copy " << dataDir << Qt::endl;
+        return 1;
+    }
+
+    {
+        CurrentDir current(workDir.path());
+
+        Data data;
+        load(data);
+
+        // rewrite everything, otherwise unchanged months are skipped
+        for(const Transaction &t : data.log.log) {
+            data.log.markMonthChanged(Month(t.date));
+        }
+        data.log.monthHashes.clear();
+
+        save(data);
+    }
+
+    // snapshot cache is not compared, it stores modification times
+    const QStringList storageFiles {QStringLiteral("*.pitm"), QStringLiteral("*.pseg")};
+
+    int mismatches {0};
+    for(const QFileInfo &file : QDir(dataDir).entryInfoList(storageFiles, QDir::Files)) {
+        QFile original(file.filePath());
+        QFile saved(QDir(copyDir).filePath(file.fileName()));
+
+        if(!original.open(QIODevice::ReadOnly) || !saved.open(QIODevice::ReadOnly) || original.readAll() != saved.readAll()) {
+            out << "differs after round trip: " << file.fileName() << Qt::endl;
+            ++mismatches;
+        }
+    }
+
+    out << "round trip: " << (mismatches ? "FAILED" : "ok") << Qt::endl;
+    return mismatches ? 1 : 0;
+}
+
+} // namespace bench
+
+} // namespace cashbook
@@ -0,0 +1,29 @@
+#-------------------------------------------------
+#
+# Benchmarks of bookkeeping along with models of widgets and analytics.
+# Same as cashbook-bench, --micro also times treemap and popup tree models.
+# Run it with -platform offscreen where there is no display.
+#
+#-------------------------------------------------
+
+include( ../bench.pri )
+
+QT += gui widgets charts
+
+TARGET = cashbook-bench-gui
+
+DEFINES += CASHBOOK_BENCH_GUI
+
+FORMS += \
+    ../../src/gui/forms/analytics/categoriesstaticchart.ui
+
+HEADERS += \
+    ../../src/bookkeeping/models.h \
+    ../../src/gui/widgets/widgets.h \
+    ../../src/gui/forms/analytics/categoriesstaticchart.h
+
+SOURCES += \
+    guibench.cpp \
+    ../../src/bookkeeping/models.cpp \
+    ../../src/gui/widgets/widgets.cpp \
+    ../../src/gui/forms/analytics/categoriesstaticchart.cpp
@@ -0,0 +1,43 @@
+#include "bench.h"
+#include "bookkeeping/models.h"
+#include "gui/widgets/widgets.h"
+#include "gui/forms/analytics/categoriesstaticchart.h"
+
+#include <memory>
+
+namespace cashbook
+{
+
+namespace bench
+{
+
+std::vector<Benchmark> guiBenchmarks(Data &data, const std::function<void(Data &)> &restore)
+{
+    // models are shared by runs, they only read the log and the trees of categories
+    const auto models = std::make_shared<DataModels>(data);
+    const auto treemap = std::make_shared<TreemapModel>();
+    treemap->init(*models);
+
+    const auto proxy = std::make_shared<PopupTreeProxyModel>();
+    proxy->setSourceModel(&models->outCategoriesModel);
+
+    return {
+        {QStringLiteral("treemapRects"), [restore, models, treemap](Data &data) {
+            restore(data);
+            treemap->updatePeriod();
+        }, [treemap](Data &) {
+            const std::vector<Rect> rects {treemap->getCurrenRects(1920.0f, 1080.0f)};
+            sink += static_cast<qint64>(rects.size());
+        }},
+        {QStringLiteral("popupFilter"), [models, proxy](Data &) {
+            proxy->setFilterString(QStringLiteral("расход.2.3"));
+        }, [proxy](Data &) {
+            proxy->applyFilter();
+            sink += proxy->rowCount();
+        }},
+    };
+}
+
+} // namespace bench
+
+} // namespace cashbook
@@ -0,0 +1,139 @@
+#include "bench.h"
+
+#ifdef CASHBOOK_BENCH_GUI
+#include <QApplication>
+#else
+#include <QCoreApplication>
+#endif
+#include <QCommandLineParser>
+
+using namespace cashbook;
+
+static bool readPositive(QTextStream &out, const QCommandLineParser &parser, const QCommandLineOption &option, int &value)
+{
+    bool ok {false};
+    value = parser.value(option).toInt(&ok);
+    if(!ok || value <= 0) {
+        out << "invalid --" << option.names().front() << ", positive number expected" << Qt::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool readRatio(QTextStream &out, const QCommandLineParser &parser, const QCommandLineOption &option, double &value)
+{
+    bool ok {false};
+    value = parser.value(option).toDouble(&ok);
+    if(!ok || value < 0.0 || value > 1.0) {
+        out << "invalid --" << option.names().front() << ", ratio within [0, 1] expected" << Qt::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef CASHBOOK_BENCH_GUI
+    QApplication a(argc, argv); // models of widgets need it
+#else
+    QCoreApplication a(argc, argv);
+#endif
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Headless benchmarks of cashbook storage and bookkeeping."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("data"), QStringLiteral("Data directory to benchmark, generate or verify. Benchmarks and verification work on a copy of it."));
+
+    QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Number of runs of every phase, 10 by default."), QStringLiteral("n"), QStringLiteral("10"));
+    QCommandLineOption codecsOption(QStringLiteral("codecs"), QStringLiteral("Compare storage codecs against Qt parsing."));
+    QCommandLineOption generateOption(QStringLiteral("generate"), QStringLiteral("Write synthetic data directory instead of benchmarking it."));
+    QCommandLineOption verifyOption(QStringLiteral("verify"), QStringLiteral("Check that data directory is saved back unchanged."));
+    QCommandLineOption yearsOption(QStringLiteral("years"), QStringLiteral("Generator: years of history."), QStringLiteral("n"), QStringLiteral("3"));
+    QCommandLineOption perDayOption(QStringLiteral("per-day"), QStringLiteral("Generator: transactions per day."), QStringLiteral("n"), QStringLiteral("5"));
+    QCommandLineOption depthOption(QStringLiteral("depth"), QStringLiteral("Generator: depth of categories trees."), QStringLiteral("n"), QStringLiteral("3"));
+    QCommandLineOption fanoutOption(QStringLiteral("fanout"), QStringLiteral("Generator: children per node of categories and wallets trees."), QStringLiteral("n"), QStringLiteral("4"));
+    QCommandLineOption walletsOption(QStringLiteral("wallets"), QStringLiteral("Generator: number of wallets."), QStringLiteral("n"), QStringLiteral("10"));
+    QCommandLineOption archivedOption(QStringLiteral("archived"), QStringLiteral("Generator: ratio of references to removed wallets and categories."), QStringLiteral("ratio"), QStringLiteral("0.05"));
+    QCommandLineOption transferDaysOption(QStringLiteral("transfer-days"), QStringLiteral("Generator: ratio of days with chains of transfers."), QStringLiteral("ratio"), QStringLiteral("0.1"));
+    QCommandLineOption microOption(QStringLiteral("micro"), QStringLiteral("Run microbenchmarks of bookkeeping hot paths on generated data."));
+    QCommandLineOption baselineOption(QStringLiteral("baseline"), QStringLiteral("Microbenchmarks: baseline to compare results with."), QStringLiteral("file"));
+    QCommandLineOption writeBaselineOption(QStringLiteral("write-baseline"), QStringLiteral("Microbenchmarks: write results to the baseline instead of comparing."));
+    QCommandLineOption thresholdOption(QStringLiteral("threshold"), QStringLiteral("Microbenchmarks: allowed slowdown against the baseline, 0.25 by default."), QStringLiteral("ratio"), QStringLiteral("0.25"));
+    QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("Generator: random seed."), QStringLiteral("n"), QStringLiteral("1"));
+    QCommandLineOption endOption(QStringLiteral("end"), QStringLiteral("Generator: newest day of the log, 2024-12-31 by default."), QStringLiteral("yyyy-MM-dd"), QStringLiteral("2024-12-31"));
+
+    parser.addOptions({
+        iterationsOption, codecsOption, generateOption, verifyOption,
+        microOption, baselineOption, writeBaselineOption, thresholdOption,
+        yearsOption, perDayOption, depthOption, fanoutOption, walletsOption, archivedOption, transferDaysOption, seedOption, endOption
+    });
+    parser.process(a);
+
+    QTextStream out(stdout);
+
+    if(parser.isSet(codecsOption)) {
+        return bench::runCodecs(out);
+    }
+
+    bool ok {false};
+    const int iterations {parser.value(iterationsOption).toInt(&ok)};
+    if(!ok || iterations <= 0) {
+        out << "invalid number of iterations" << Qt::endl;
+        return 1;
+    }
+
+    if(parser.isSet(microOption)) {
+        if(parser.isSet(writeBaselineOption) && !parser.isSet(baselineOption)) {
+            out << "--write-baseline needs --baseline file" << Qt::endl;
+            return 1;
+        }
+
+        const double threshold {parser.value(thresholdOption).toDouble(&ok)};
+        if(!ok || threshold < 0.0) {
+            out << "invalid threshold" << Qt::endl;
+            return 1;
+        }
+
+        return bench::runMicro(out, iterations, parser.value(baselineOption), parser.isSet(writeBaselineOption), threshold);
+    }
+
+    const QStringList args {parser.positionalArguments()};
+    if(args.size() != 1) {
+        parser.showHelp(1);
+    }
+
+    if(parser.isSet(generateOption)) {
+        // empty trees or wallet lists leave the generator nothing to pick from
+        bench::GeneratorOptions options;
+        const bool valid = readPositive(out, parser, yearsOption, options.years)
+                        && readPositive(out, parser, perDayOption, options.perDay)
+                        && readPositive(out, parser, depthOption, options.depth)
+                        && readPositive(out, parser, fanoutOption, options.fanout)
+                        && readPositive(out, parser, walletsOption, options.wallets)
+                        && readRatio(out, parser, archivedOption, options.archived)
+                        && readRatio(out, parser, transferDaysOption, options.transferDays);
+        if(!valid) {
+            return 1;
+        }
+
+        options.seed = parser.value(seedOption).toULongLong(&ok);
+        if(!ok) {
+            out << "invalid seed" << Qt::endl;
+            return 1;
+        }
+
+        options.end = QDate::fromString(parser.value(endOption), Qt::ISODate);
+        if(!options.end.isValid()) {
+            out << "invalid end date" << Qt::endl;
+            return 1;
+        }
+
+        return bench::runGenerate(out, args.front(), options);
+    }
+
+    if(parser.isSet(verifyOption)) {
+        return bench::runVerify(out, args.front());
+    }
+
+    return bench::runPhases(out, args.front(), iterations);
+}
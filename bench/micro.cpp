@@ -0,0 +1,184 @@
+#include "bench.h"
+#include "bookkeeping/bookkeeping.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <functional>
+#include <map>
+
+namespace cashbook
+{
+
+namespace bench
+{
+
+static std::vector<Benchmark> benchmarks(Data &generated, const std::deque<Transaction> &original)
+{
+    const std::function<void(Data &)> restore = [&original](Data &data) {
+        data.log.log = original;
+        data.log.unanchored = 0;
+        data.log.normalizedMonths.clear();
+        data.log.invalidateIndices();
+        data.log.invalidateTotals();
+    };
+
+    // anchoring moves money of wallets, so every run should start from the same amounts
+    std::vector<std::pair<Node<Wallet> *, Money>> amounts;
+    for(Node<Wallet> *wallet : generated.wallets.rootItem->toList()) {
+        amounts.emplace_back(wallet, wallet->data.amount);
+    }
+    const BriefStatistics brief {generated.statistics.brief};
+
+    std::vector<Benchmark> res {
+        {QStringLiteral("normalizeData"), restore, [](Data &data) {
+            data.log.normalizeData();
+        }},
+        {QStringLiteral("updateTask"), [restore](Data &data) {
+            restore(data);
+            data.log.categoryTotals(); // built once per data set, runs time the queries only
+        }, [](Data &data) {
+            for(Task task : data.tasks.active.tasks) {
+                data.log.updateTask(task);
+                sink += task.spent.as_cents();
+            }
+        }},
+        {QStringLiteral("anchoreTransactions"), [restore, amounts, brief](Data &data) {
+            restore(data);
+            for(const auto &[wallet, amount] : amounts) {
+                wallet->data.amount = amount;
+                data.wallets.invalidateTreeAmount(wallet);
+            }
+            data.statistics.brief = brief;
+            data.log.unanchored = static_cast<int>(data.log.log.size());
+        }, [](Data &data) {
+            data.log.anchoreTransactions();
+        }},
+        {QStringLiteral("propagateMoney"), restore, [](Data &data) {
+            CategoryMoneyMap categories;
+            for(const Transaction &t : data.log.log) {
+                if(t.type == Transaction::Type::Out && t.category.isValidPointer()) {
+                    categories.propagateMoney(t.category.toPointer(), t.amount);
+                }
+            }
+            sink += static_cast<qint64>(categories.size());
+        }},
+        {QStringLiteral("formatMoney"), restore, [](Data &data) {
+            for(const Transaction &t : data.log.log) {
+                sink += formatMoney(t.amount).size();
+            }
+        }},
+        {QStringLiteral("pathToString"), restore, [](Data &data) {
+            for(const Transaction &t : data.log.log) {
+                if(t.type != Transaction::Type::Transfer && t.category.isValidPointer()) {
+                    sink += pathToString(t.category.toPointer()).size();
+                }
+            }
+        }},
+    };
+
+#ifdef CASHBOOK_BENCH_GUI
+    for(Benchmark &benchmark : guiBenchmarks(generated, restore)) {
+        res.push_back(std::move(benchmark));
+    }
+#endif
+
+    return res;
+}
+
+static bool readBaseline(const QString &fileName, std::map<QString, qint64> &baseline)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QJsonObject benchmarks {QJsonDocument::fromJson(file.readAll()).object().value("benchmarks").toObject()};
+    for(auto it = benchmarks.begin(); it != benchmarks.end(); ++it) {
+        baseline[it.key()] = it.value().toInteger();
+    }
+
+    return true;
+}
+
+static bool writeBaselineFile(const QString &fileName, const std::map<QString, qint64> &results)
+{
+    QJsonObject benchmarks;
+    for(const auto &[name, median] : results) {
+        benchmarks.insert(name, median);
+    }
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    file.write(QJsonDocument(QJsonObject {{"benchmarks", benchmarks}}).toJson());
+    return true;
+}
+
+int runMicro(QTextStream &out, int iterations, const QString &baselineFile, bool writeBaseline, double threshold)
+{
+    std::map<QString, qint64> baseline;
+    const bool compare {!baselineFile.isEmpty() && !writeBaseline};
+    if(compare && !readBaseline(baselineFile, baseline)) {
+        out << "can not read baseline " << baselineFile << Qt::endl;
+        return 1;
+    }
+
+    std::map<QString, qint64> results;
+    int regressions {0};
+
+    for(const int years : {1, 4, 16}) {
+        GeneratorOptions options;
+        options.years = years;
+
+        Data data;
+        generate(data, options);
+        const std::deque<Transaction> original {data.log.log};
+
+        out << years << "y: " << original.size() << " transactions" << Qt::endl;
+
+        for(const Benchmark &benchmark : benchmarks(data, original)) {
+            Samples samples;
+            for(int i = 0; i<iterations; ++i) {
+                benchmark.prepare(data);
+                samples.add(elapsed([&]() {
+                    benchmark.run(data);
+                }));
+            }
+
+            const QString name {QStringLiteral("%1/%2y").arg(benchmark.name).arg(years)};
+            report(out, name, samples);
+            results[name] = samples.median();
+
+            auto it = baseline.find(name);
+            if(compare && it != baseline.end() && samples.median() > it->second * (1.0 + threshold)) {
+                out << "  regression: baseline median " << QString::number(static_cast<double>(it->second) / 1e6, 'f', 3) << " ms" << Qt::endl;
+                ++regressions;
+            }
+        }
+    }
+
+    out << "checksum " << sink << Qt::endl;
+
+    if(writeBaseline) {
+        if(!writeBaselineFile(baselineFile, results)) {
+            out << "can not write baseline " << baselineFile << Qt::endl;
+            return 1;
+        }
+        out << "baseline written to " << baselineFile << Qt::endl;
+    }
+
+    if(regressions) {
+        out << regressions << " benchmarks regressed by more than " << threshold * 100 << "%" << Qt::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+} // namespace bench
+
+} // namespace cashbook
@@ -0,0 +1,85 @@
+#include "bench.h"
+#include "bookkeeping/bookkeeping.h"
+#include "bookkeeping/serialization.h"
+
+#include <QTemporaryDir>
+
+namespace cashbook
+{
+
+namespace bench
+{
+
+int runPhases(QTextStream &out, const QString &dataDir, int iterations)
+{
+    QTemporaryDir workDir;
+    if(!workDir.isValid()) {
+        out << "can not create temporary directory" << Qt::endl;
+        return 1;
+    }
+
+    // storage paths are relative to the current directory
+    if(!copyData(dataDir, workDir.filePath(QStringLiteral("data")))) {
+        out << "can not copy " << dataDir << Qt::endl;
+        return 1;
+    }
+
+    CurrentDir current(workDir.path());
+
+    Samples loadTimes;
+    Samples saveTimes;
+    Samples normalizeTimes;
+    Samples tasksTimes;
+    Samples categoriesTimes;
+    size_t rows {0};
+
+    for(int i = 0; i<iterations; ++i) {
+        Data data;
+        loadTimes.add(elapsed([&data]() {
+            load(data);
+        }));
+        rows = data.log.log.size();
+
+        // rewrite the whole log, otherwise unchanged months are skipped
+        for(const Transaction &t : data.log.log) {
+            data.log.markMonthChanged(Month(t.date));
+        }
+        data.log.monthHashes.clear();
+
+        saveTimes.add(elapsed([&data]() {
+            save(data);
+        }));
+
+        tasksTimes.add(elapsed([&data]() {
+            data.updateTasks();
+        }));
+
+        categoriesTimes.add(elapsed([&data]() {
+            CategoryMoneyMap inCategories;
+            CategoryMoneyMap outCategories;
+            if(!data.log.log.empty()) {
+                data.log.aggregateCategories(data.log.log.back().date, data.log.log.front().date, inCategories, outCategories);
+            }
+        }));
+
+        // measure a full pass rather than months known to be normalized.
+        // Goes last because it changes the log
+        data.log.normalizedMonths.clear();
+        normalizeTimes.add(elapsed([&data]() {
+            data.log.normalizeData();
+        }));
+    }
+
+    out << dataDir << ": " << rows << " transactions, " << iterations << " iterations" << Qt::endl;
+    report(out, QStringLiteral("load"), loadTimes);
+    report(out, QStringLiteral("save"), saveTimes);
+    report(out, QStringLiteral("normalize"), normalizeTimes);
+    report(out, QStringLiteral("tasks"), tasksTimes);
+    report(out, QStringLiteral("categories"), categoriesTimes);
+
+    return 0;
+}
+
+} // namespace bench
+
+} // namespace cashbook
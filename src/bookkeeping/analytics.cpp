@@ -1,5 +1,6 @@
 #include "analytics.h"
 #include "ui_mainwindow.h"
+#include "bookkeeping/trace.h"
 
 #include <QComboBox>
 #include <QRectF>
@@ -30,6 +31,7 @@ static const QString NoBankOption = QObject::tr("Вне банка");
 
 void WalletsAnalytics::initUi(Ui::MainWindow* ui)
 {
+    CASHBOOK_TRACE_SCOPE("WalletsAnalytics::initUi");
     m_criteriaCombo = ui->walletsAnalysisCriteriaCombo;
     m_ownerCombo = ui->walletsAnalysisOwnerCombo;
     m_bankCombo = ui->walletsAnalysisBankCombo;
@@ -241,6 +243,7 @@ CategoriesAnalytics::CategoriesAnalytics(DataModels& dataModels, QWidget* parent
 
 void CategoriesAnalytics::initUi(Ui::MainWindow* ui)
 {
+    CASHBOOK_TRACE_SCOPE("CategoriesAnalytics::initUi");
     m_categoryTypeCombo = ui->categoriesTypeBox;
     m_categoryCombo = ui->categoriesCategoryButton;
     m_dateFromEdit = ui->categoriesDateFrom;
@@ -394,17 +397,6 @@ void CategoriesAnalytics::initUi(Ui::MainWindow* ui)
     m_canUpdate = true;
 }
 
-static bool isNodeBelongsTo(const Node<Category> *node, const Node<Category> *parent) {
-    while(node) {
-        if(node == parent) {
-                return true;
-        }
-        node = node->parent;
-    }
-
-    return false;
-}
-
 void CategoriesAnalytics::updateAnalytics()
 {
     if (!m_canUpdate) {
@@ -431,29 +423,24 @@ void CategoriesAnalytics::updateAnalytics()
         return;
     }
 
-    std::map<QDate, Money> data;
-
-    const auto log = m_dataModels.m_data.log.log;
+    // chart is redrawn once older months are loaded
+    m_dataModels.logModel.fetchOlderAsync(m_dateFromEdit->date());
 
-    for(const Transaction& t : log) {
-        if(t.date > m_dateToEdit->dateTime().date()) {
-            continue;
-        }
+    std::map<QDate, Money> data;
 
-        if(t.date < m_dateFromEdit->dateTime().date()) {
-            break;
+    const CategoryTotals &totals = m_dataModels.m_data.log.categoryTotals();
+    const auto addDay = [this, &data](const QDate &day, const Money &amount) {
+        if (getDensity() == Density::Day) {
+            data[day] += amount;
+        } else {
+            // month density
+            QDate date(day.year(), day.month(), 1);
+            data[date] += amount;
         }
+    };
 
-        const Node<Category>* categoryNode = t.category.toPointer();
-        if (categoryNode && isNodeBelongsTo(categoryNode, analyzedCategory)) {
-            if (getDensity() == Density::Day) {
-                data[t.date] += t.amount;
-            } else {
-                // month density
-                QDate date(t.date.year(), t.date.month(), 1);
-                data[date] += t.amount;
-            }
-        }
+    for(Transaction::Type::t type : Transaction::Type::enumerate()) {
+        totals.forEachDay(analyzedCategory, type, m_dateFromEdit->dateTime().date(), m_dateToEdit->dateTime().date(), addDay);
     }
 
     qreal yMin = std::numeric_limits<qreal>::max();
@@ -1,5 +1,9 @@
 #include "basic_types.h"
 
+#include <QReadWriteLock>
+#include <QSet>
+#include <atomic>
+
 namespace cashbook
 {
 
@@ -89,6 +93,121 @@ void IdableString::setString(const QString &str) {
     QString::operator =(str);
 }
 
+struct StringStorage
+{
+    QReadWriteLock lock;
+    QSet<QString> strings;
+};
+
+static StringStorage &stringStorage()
+{
+    static StringStorage storage;
+    return storage;
+}
+
+QString StringPool::intern(const QString &str)
+{
+    if(str.isEmpty()) {
+        return QString();
+    }
+
+    StringStorage &storage = stringStorage();
+
+    {
+        QReadLocker locker(&storage.lock);
+        const auto it = storage.strings.constFind(str);
+        if(it != storage.strings.constEnd()) {
+            return *it;
+        }
+    }
+
+    QWriteLocker locker(&storage.lock);
+    return *storage.strings.insert(str);
+}
+
+int StringPool::collect()
+{
+    StringStorage &storage = stringStorage();
+
+    QWriteLocker locker(&storage.lock);
+
+    int removed = 0;
+    for(auto it = storage.strings.begin(); it != storage.strings.end(); ) {
+        // pool's own copy is the only one left
+        if(!it->data_ptr().isShared()) {
+            it = storage.strings.erase(it);
+            ++removed;
+        } else {
+            ++it;
+        }
+    }
+
+    return removed;
+}
+
+struct ArchiveStorage
+{
+    QReadWriteLock lock;
+    std::vector<QString> strings;
+    QHash<QString, quint32> indices;
+};
+
+static ArchiveStorage &archiveStorage()
+{
+    static ArchiveStorage storage;
+    return storage;
+}
+
+quint32 ArchivePool::intern(const QString &str)
+{
+    ArchiveStorage &storage = archiveStorage();
+
+    {
+        QReadLocker locker(&storage.lock);
+        const auto it = storage.indices.constFind(str);
+        if(it != storage.indices.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&storage.lock);
+    const auto it = storage.indices.constFind(str);
+    if(it != storage.indices.constEnd()) {
+        return it.value();
+    }
+
+    const quint32 index = static_cast<quint32>(storage.strings.size());
+    storage.strings.push_back(str);
+    storage.indices.insert(str, index);
+    return index;
+}
+
+QString ArchivePool::get(quint32 index)
+{
+    ArchiveStorage &storage = archiveStorage();
+
+    QReadLocker locker(&storage.lock);
+    return storage.strings[index];
+}
+
+static quint64 pathGeneration {1};
+
+quint64 PathCache::current()
+{
+    return pathGeneration;
+}
+
+void PathCache::invalidateAll()
+{
+    ++pathGeneration;
+}
+
+qint64 TreeInterval::reserve(qint64 count)
+{
+    static std::atomic<qint64> next {0};
+    return next.fetch_add(count);
+}
+
 static QString getCurrencySymbol(Currency::t type)
 {
     switch(type) {
@@ -8,6 +8,7 @@
 #include <QUuid>
 #include <QDate>
 #include <QVariant>
+#include <QHash>
 #include <functional>
 #include <vector>
 
@@ -55,6 +56,36 @@ public:
 using Owner = IdableString;
 using Bank = IdableString;
 
+/**
+ * @brief Index of `Idable` objects by their ids.
+ * @details Files refer to owners, banks, wallets and categories by their
+ *          ids, so such references are resolved through this index instead
+ *          of scanning over the whole collection.
+ */
+template <class T>
+class IdIndex
+{
+public:
+    void insert(const QUuid &id, const T *item) {
+        m_items.insert(id, item);
+    }
+
+    void remove(const QUuid &id) {
+        m_items.remove(id);
+    }
+
+    const T *find(const QUuid &id) const {
+        return m_items.value(id, nullptr);
+    }
+
+    void clear() {
+        m_items.clear();
+    }
+
+private:
+    QHash<QUuid, const T *> m_items;
+};
+
 class ArchiveString
 {
 public:
@@ -74,6 +105,75 @@ private:
     QString m_str;
 };
 
+/**
+ * @brief Pool of interned strings.
+ * @details Holds one shared copy of every distinct string handed out as
+ * `PooledString`. Entries nobody refers to anymore are dropped by `collect()`,
+ * which is called on save. Access is thread-safe.
+ */
+class StringPool
+{
+public:
+    static QString intern(const QString &str);
+    static int collect();
+};
+
+/**
+ * @brief Interned string.
+ * @details Equal values share a single `StringPool` buffer, so repeated
+ * notes cost one allocation and compare by pointer.
+ */
+class PooledString
+{
+public:
+    PooledString() = default;
+
+    PooledString(const QString &str)
+        : m_str(StringPool::intern(str))
+    {}
+
+    PooledString(const char *str)
+        : PooledString(QString(str))
+    {}
+
+    const QString &get() const {
+        return m_str;
+    }
+
+    bool isEmpty() const {
+        return m_str.isEmpty();
+    }
+
+    void clear() {
+        m_str.clear();
+    }
+
+    bool operator==(const PooledString &other) const {
+        return m_str.constData() == other.m_str.constData();
+    }
+
+    bool operator!=(const PooledString &other) const {
+        return !(*this == other);
+    }
+
+private:
+    QString m_str;
+};
+
+/**
+ * @brief Pool of archived strings.
+ * @details Archived references repeat the same few paths over the whole log,
+ * so every distinct string is stored here once and `ArchPointer` keeps only
+ * its index. Strings are never removed. Access is thread-safe because month
+ * files are parsed concurrently.
+ */
+class ArchivePool
+{
+public:
+    static quint32 intern(const QString &str);
+    static QString get(quint32 index);
+};
+
 /**
  * @brief Archiveable pointer.
  * @details Wrapper around existing pointer OR archived nonexisting one.
@@ -81,55 +181,56 @@ private:
  * `ArchPointer<T>` wrapper allows to contain:
  * - valid `const T *` which belongs to any `Owner`;
  * - `QString` representing former `const T*` which does not exist anymore.
+ *
+ * Both are packed into a single word: pointer with lowest bit cleared or
+ * `ArchivePool` index shifted left with lowest bit set. Comparison and
+ * hashing therefore never touch strings.
  */
 template <class T>
-class ArchPointer : public QVariant
+class ArchPointer
 {
 public:
-    ArchPointer() // valid null pointer by default
-        : QVariant(QVariant::fromValue<const T*>(nullptr))
-    {}
+    ArchPointer() = default; // valid null pointer by default
 
     ArchPointer(const QVariant &v)
-        : QVariant(v)
-    {}
+    {
+        if(v.metaType() == QMetaType::fromType<const T*>()) {
+            m_value = fromPointer(v.value<const T*>());
+        } else {
+            m_value = fromArchive(v.toString());
+        }
+    }
 
     ArchPointer(const T *node)
-        : QVariant(QVariant::fromValue<const T*>(node))
+        : m_value(fromPointer(node))
     {}
 
     ArchPointer(const ArchiveString &str)
-        : QVariant(QVariant::fromValue<QString>(str.get()))
+        : m_value(fromArchive(str.get()))
     {}
 
     ArchPointer &operator =(const T *node)
     {
-        this->QVariant::operator =(QVariant::fromValue<const T*>(node));
+        m_value = fromPointer(node);
         return *this;
     }
 
     ArchPointer &operator =(const ArchiveString &str)
     {
-        this->QVariant::operator =(str.get());
-        return *this;
-    }
-
-    ArchPointer &operator =(ArchiveString &&str)
-    {
-        this->QVariant::operator =(std::move(str.get()));
+        m_value = fromArchive(str.get());
         return *this;
     }
 
     const T *toPointer() const {
-        return value<const T*>();
+        return isValidPointer() ? reinterpret_cast<const T*>(m_value) : nullptr;
     }
 
     bool isValidPointer() const {
-        return canConvert<const T*>();
+        return !(m_value & ArchiveTag);
     }
 
     bool isNullPointer() const {
-        return isValidPointer() && toPointer() == nullptr;
+        return m_value == 0;
     }
 
     bool isArchived() const {
@@ -137,8 +238,52 @@ public:
     }
 
     void setNull() {
-        this->QVariant::operator =(QVariant::fromValue<const T*>(nullptr));
+        m_value = 0;
+    }
+
+    /**
+     * @brief Archived string. Empty for valid pointers.
+     */
+    QString toString() const {
+        return isArchived() ? ArchivePool::get(static_cast<quint32>(m_value >> 1)) : QString();
+    }
+
+    /**
+     * @brief Reference as model data: `const T*` or archived `QString`.
+     */
+    QVariant toVariant() const {
+        if(isValidPointer()) {
+            return QVariant::fromValue<const T*>(toPointer());
+        } else {
+            return QVariant(toString());
+        }
+    }
+
+    quintptr key() const {
+        return m_value;
+    }
+
+    bool operator==(const ArchPointer &other) const {
+        return m_value == other.m_value;
     }
+
+    bool operator!=(const ArchPointer &other) const {
+        return m_value != other.m_value;
+    }
+
+private:
+    static constexpr quintptr ArchiveTag {1};
+
+    static quintptr fromPointer(const T *pointer) {
+        static_assert(alignof(T) > 1, "lowest pointer bit is used as archive tag");
+        return reinterpret_cast<quintptr>(pointer);
+    }
+
+    static quintptr fromArchive(const QString &str) {
+        return (static_cast<quintptr>(ArchivePool::intern(str)) << 1) | ArchiveTag;
+    }
+
+    quintptr m_value {0};
 };
 
 /**
@@ -157,47 +302,109 @@ public:
 template <class T>
 using ArchNode = ArchPointer<Node<T>>;
 
+/**
+ * @brief Position of a node in a pre-order walk of its tree.
+ * @details `[begin, end)` spans the node and all its descendants, so subtree
+ *          membership is two integer compares. Numbers are never reused
+ *          across trees or renumberings, so intervals of different trees never
+ *          overlap.
+ */
+struct TreeInterval
+{
+    qint64 begin {0};
+    qint64 end {0};
+
+    bool contains(const TreeInterval &other) const {
+        return begin <= other.begin && other.begin < end;
+    }
+
+    /**
+     * Reserves `count` consecutive numbers not given out before.
+     */
+    static qint64 reserve(qint64 count);
+};
+
+/**
+ * @brief Display strings of a tree node, built on first use.
+ * @details Strings are valid while their generation matches `current()`.
+ *          Anyone who renames or moves a node should call `invalidateAll()`:
+ *          it is rare, and paths of the whole subtree depend on it.
+ */
+struct PathCache
+{
+    PathCache() = default;
+
+    // strings belong to a particular node, copies start empty
+    PathCache(const PathCache &) {}
+    PathCache &operator =(const PathCache &) {
+        pathGeneration = 0;
+        shortPathGeneration = 0;
+        return *this;
+    }
+
+    static quint64 current();
+    static void invalidateAll();
+
+    mutable QString path;
+    mutable QString shortPath;
+    mutable quint64 pathGeneration {0};
+    mutable quint64 shortPathGeneration {0};
+};
+
 const QString pathConcat {"/"};
 
 template <class T>
 QString extractPathString(const Node<T> *node);
 
 template <class T>
-QString pathToString(const Node<T> *node)
+const QString &pathToString(const Node<T> *node)
 {
+    static const QString empty;
     if(!node) {
-        return "";
+        return empty;
     }
 
-    QStringList l;
-    while(node->parent) {
-        l.push_front(extractPathString(node));
-        node = node->parent;
+    const PathCache &cache = node->data.paths;
+    if(cache.pathGeneration != PathCache::current()) {
+        QStringList l;
+        for(const Node<T> *item = node; item->parent; item = item->parent) {
+            l.push_front(extractPathString(item));
+        }
+
+        cache.path = l.join(pathConcat);
+        cache.pathGeneration = PathCache::current();
     }
 
-    return l.join(pathConcat);
+    return cache.path;
 }
 
 template <class T>
-QString pathToShortString(const Node<T> *node)
+const QString &pathToShortString(const Node<T> *node)
 {
+    static const QString empty;
     if(!node) {
-        return "";
+        return empty;
     }
 
-    QString path = extractPathString(node);
-    if(node && node->parent) {
-        QString parentPath = extractPathString(node->parent);
-        if(!parentPath.isEmpty()) {
-            path += " (" + parentPath + ")";
+    const PathCache &cache = node->data.paths;
+    if(cache.shortPathGeneration != PathCache::current()) {
+        QString path = extractPathString(node);
+        if(node->parent) {
+            QString parentPath = extractPathString(node->parent);
+            if(!parentPath.isEmpty()) {
+                path += " (" + parentPath + ")";
+            }
         }
+
+        cache.shortPath = path;
+        cache.shortPathGeneration = PathCache::current();
     }
 
-    return path;
+    return cache.shortPath;
 }
 
 template <class T>
-QString archNodeToString(ArchNode<T> arch)
+QString archNodeToString(const ArchNode<T> &arch)
 {
     if(arch.isValidPointer()) {
         return pathToString(arch.toPointer());
@@ -207,7 +414,7 @@ QString archNodeToString(ArchNode<T> arch)
 }
 
 template <class T>
-QString archNodeToShortString(ArchNode<T> arch)
+QString archNodeToShortString(const ArchNode<T> &arch)
 {
     if(arch.isValidPointer()) {
         return pathToShortString(arch.toPointer());
@@ -317,11 +524,7 @@ namespace std
     {
         std::size_t operator()(const cashbook::ArchNode<T>& node) const
         {
-            if(node.isValidPointer()) {
-                return std::hash<const Node<T>*>()(node.toPointer());
-            } else {
-                return std::hash<std::string>()(node.toString().toStdString());
-            }
+            return std::hash<quintptr>()(node.key());
         }
     };
 }
@@ -1,7 +1,10 @@
 #include "bookkeeping/bookkeeping.h"
+#include "bookkeeping/codecs.h"
+#include "bookkeeping/trace.h"
 #include <askelib_qt/std/fs.h>
 
 #include <QRegularExpression>
+#include <QSet>
 
 namespace cashbook
 {
@@ -23,41 +26,11 @@ QString Wallet::Type::toString(Type::t type) {
 }
 
 QString Wallet::Type::toConfigString(Type::t type) {
-    switch(type) {
-        case Count:
-        case Common: return QStringLiteral("Common");
-        case Cash: return QStringLiteral("Cash");
-        case Card: return QStringLiteral("Card");
-        case Account: return QStringLiteral("Account");
-        case Deposit: return QStringLiteral("Deposit");
-        case Investment: return QObject::tr("Investment");
-        case CryptoCurrency: return QStringLiteral("CryptoCurrency");
-        case Points: return QObject::tr("Points");
-    }
-
-    return QString();
+    return codecs::toQString(codecs::walletTypes.name(type));
 }
 
 Wallet::Type::t Wallet::Type::fromConfigString(const QString &str) {
-    if(str == "Common") {
-        return Common;
-    } else if(str == "Cash") {
-        return Cash;
-    } else if(str == "Card") {
-        return Card;
-    } else if(str == "Account") {
-        return Account;
-    } else if(str == "Deposit") {
-        return Deposit;
-    } else if(str == "Investment") {
-        return Investment;
-    } else if(str == "CryptoCurrency") {
-        return CryptoCurrency;
-    } else if(str == "Points") {
-        return Points;
-    } else {
-        return Common;
-    }
+    return codecs::walletTypes.fromName(codecs::toStringView(str.toLatin1()));
 }
 
 QString Wallet::Availability::toString(Availability::t type)
@@ -81,48 +54,12 @@ QString Wallet::Availability::toString(Availability::t type)
 
 QString Wallet::Availability::toConfigString(Availability::t type)
 {
-    switch(type) {
-        case Count:
-        case Free: return QStringLiteral("Free");
-        case InAMonth: return QStringLiteral("InAMonth");
-        case InAQarter: return QStringLiteral("InAQarter");
-        case InAYear: return QStringLiteral("InAYear");
-        case In3Years: return QStringLiteral("In3Years");
-        case In5Years: return QStringLiteral("In5Years");
-        case In10Years: return QStringLiteral("In10Years");
-        case In20Years: return QStringLiteral("In20Years");
-        case AfterRetirement: return QStringLiteral("AfterRetirement");
-        case ForFutureGenerations: return QStringLiteral("ForFutureGenerations");
-    }
-
-    return QString();
+    return codecs::toQString(codecs::availabilities.name(type));
 }
 
 Wallet::Availability::t Wallet::Availability::fromConfigString(const QString &str)
 {
-    if(str == "Free") {
-        return Free;
-    } else if(str == "InAMonth") {
-        return InAMonth;
-    } else if(str == "InAQarter") {
-        return InAQarter;
-    } else if(str == "InAYear") {
-        return InAYear;
-    } else if(str == "In3Years") {
-        return In3Years;
-    } else if(str == "In5Years") {
-        return In5Years;
-    } else if(str == "In10Years") {
-        return In10Years;
-    } else if(str == "In20Years") {
-        return In20Years;
-    } else if(str == "AfterRetirement") {
-        return AfterRetirement;
-    } else if(str == "ForFutureGenerations") {
-        return ForFutureGenerations;
-    } else {
-        return Free;
-    }
+    return codecs::availabilities.fromName(codecs::toStringView(str.toLatin1()));
 }
 
 QString Wallet::InvestmentInfo::Type::toString(Type::t type)
@@ -142,36 +79,12 @@ QString Wallet::InvestmentInfo::Type::toString(Type::t type)
 
 QString Wallet::InvestmentInfo::Type::toConfigString(Type::t type)
 {
-    switch(type) {
-        case Count:
-        case Common: return QStringLiteral("Common");
-        case Currency: return QStringLiteral("Currency");
-        case Stocks: return QStringLiteral("Stocks");
-        case Metals: return QStringLiteral("Metals");
-        case CryptoCurrency: return QStringLiteral("CryptoCurrency");
-        case RealEstate: return QStringLiteral("RealEstate");
-    }
-
-    return QString();
+    return codecs::toQString(codecs::investmentTypes.name(type));
 }
 
 Wallet::InvestmentInfo::Type::t Wallet::InvestmentInfo::Type::fromConfigString(const QString &str)
 {
-    if(str == "Common") {
-        return Common;
-    } else if(str == "Currency") {
-        return Currency;
-    } else if(str == "Stocks") {
-        return Stocks;
-    } else if(str == "Metals") {
-        return Metals;
-    } else if(str == "CryptoCurrency") {
-        return CryptoCurrency;
-    } else if(str == "RealEstate") {
-        return RealEstate;
-    } else {
-        return Common;
-    }
+    return codecs::investmentTypes.fromName(codecs::toStringView(str.toLatin1()));
 }
 
 Wallet::Wallet()
@@ -204,24 +117,11 @@ QString Transaction::Type::toString(Type::t type) {
 }
 
 QString Transaction::Type::toConfigString(Type::t type) {
-    switch(type) {
-        case In: return QStringLiteral("In");
-        default:
-        case Out: return QStringLiteral("Out");
-        case Transfer: return QStringLiteral("Transfer");
-    }
+    return codecs::toQString(codecs::transactionTypes.name(type));
 }
 
 Transaction::Type::t Transaction::Type::fromConfigString(const QString &str) {
-    if(str == "In") {
-        return In;
-    } else if(str == "Out") {
-        return Out;
-    } else if(str == "Transfer") {
-        return Transfer;
-    } else {
-        return Out;
-    }
+    return codecs::transactionTypes.fromName(codecs::toStringView(str.toLatin1()));
 }
 
 template <>
@@ -234,6 +134,457 @@ QString extractPathString<Wallet>(const Node<Wallet> *node) {
     return node ? node->data.name : "";
 }
 
+void BriefStatistics::add(const Transaction &t)
+{
+    apply(t, false);
+}
+
+void BriefStatistics::subtract(const Transaction &t)
+{
+    apply(t, true);
+}
+
+void BriefStatistics::apply(const Transaction &t, bool subtract)
+{
+    if(t.type != Transaction::Type::In && t.type != Transaction::Type::Out) {
+        return;
+    }
+
+    const auto &archNode = t.category;
+    const bool isRegular = archNode.isValidPointer() && archNode.toPointer() && archNode.toPointer()->data.regular;
+
+    BriefStatisticsRecord& monthBrief = (*this)[Month(t.date)];
+
+    const Money amount = subtract ? Money() - t.amount : t.amount;
+
+    Money& common = t.type == Transaction::Type::In ? monthBrief.common.received : monthBrief.common.spent;
+    common += amount;
+    if(isRegular) {
+        Money& regular = t.type == Transaction::Type::In ? monthBrief.regular.received : monthBrief.regular.spent;
+        regular += amount;
+    }
+}
+
+void BriefStatistics::merge(const BriefStatistics &other)
+{
+    for(const auto &[month, record] : other) {
+        BriefStatisticsRecord &total = (*this)[month];
+        total.common.spent += record.common.spent;
+        total.common.received += record.common.received;
+        total.regular.spent += record.regular.spent;
+        total.regular.received += record.regular.received;
+    }
+}
+
+void AggregateEngine::inserted(const Transaction &t)
+{
+    for(LogAggregate *aggregate : m_aggregates) {
+        aggregate->inserted(t);
+    }
+}
+
+void AggregateEngine::removed(const Transaction &t)
+{
+    for(LogAggregate *aggregate : m_aggregates) {
+        aggregate->removed(t);
+    }
+}
+
+void AggregateEngine::edited(const Transaction &before, const Transaction &after)
+{
+    removed(before);
+    inserted(after);
+}
+
+void AggregateEngine::categoryMoved(const Node<Category> *node)
+{
+    for(LogAggregate *aggregate : m_aggregates) {
+        aggregate->categoryMoved(node);
+    }
+}
+
+void BriefAggregate::inserted(const Transaction &t)
+{
+    m_brief.add(t);
+}
+
+void BriefAggregate::removed(const Transaction &t)
+{
+    m_brief.subtract(t);
+}
+
+void BriefAggregate::categoryMoved(const Node<Category> *node)
+{
+    Q_UNUSED(node); // brief does not depend on hierarchy
+}
+
+void TasksAggregate::inserted(const Transaction &t)
+{
+    apply(t, false);
+}
+
+void TasksAggregate::removed(const Transaction &t)
+{
+    apply(t, true);
+}
+
+void TasksAggregate::categoryMoved(const Node<Category> *node)
+{
+    Q_UNUSED(node);
+    for(TasksListsData *list : {&m_tasks.active, &m_tasks.completed}) {
+        for(Task &task : list->tasks) {
+            // partial sums would replace the cached ones, such tasks are summed once history is fetched
+            if(m_log.isLoadedSince(task.from)) {
+                m_log.updateTask(task);
+            }
+        }
+    }
+}
+
+void TasksAggregate::apply(const Transaction &t, bool subtract)
+{
+    if(t.type == Transaction::Type::Transfer) {
+        return;
+    }
+
+    const Node<Category> *category = t.category.toPointer();
+    if(!category) {
+        return;
+    }
+
+    for(TasksListsData *list : {&m_tasks.active, &m_tasks.completed}) {
+        for(Task &task : list->tasks) {
+            if(task.type != t.type || t.date < task.from || t.date > task.to) {
+                continue;
+            }
+
+            if(!isNodeBelongsTo(category, task.category.toPointer())) {
+                continue;
+            }
+
+            task.spent = subtract ? task.spent - t.amount : task.spent + t.amount;
+            task.rest = task.amount - task.spent;
+        }
+    }
+}
+
+Money WalletsData::treeAmount(const Node<Wallet> *node) const
+{
+    if(node->isLeaf()) {
+        return node->data.amount;
+    }
+
+    if(!node->data.treeAmountValid) {
+        Money res;
+        for(const Node<Wallet> *child : node->children) {
+            res += treeAmount(child);
+        }
+        node->data.treeAmount = res;
+        node->data.treeAmountValid = true;
+    }
+
+    return node->data.treeAmount;
+}
+
+std::vector<const Node<Wallet> *> WalletsData::invalidateTreeAmount(const Node<Wallet> *node)
+{
+    std::vector<const Node<Wallet> *> res;
+    for( ; node; node = node->parent) {
+        node->data.treeAmountValid = false;
+        res.push_back(node);
+    }
+
+    return res;
+}
+
+void LogColumns::clear()
+{
+    days.clear();
+    types.clear();
+    categories.clear();
+    from.clear();
+    to.clear();
+    cents.clear();
+}
+
+void LogColumns::append(const Transaction &t)
+{
+    days.emplace_back();
+    types.emplace_back();
+    categories.emplace_back();
+    from.emplace_back();
+    to.emplace_back();
+    cents.emplace_back();
+    set(size()-1, t);
+}
+
+void LogColumns::set(size_t row, const Transaction &t)
+{
+    days[row] = t.date.toJulianDay();
+    types[row] = static_cast<quint8>(t.type);
+    categories[row] = t.type != Transaction::Type::Transfer ? t.category.toPointer() : nullptr;
+    from[row] = t.type != Transaction::Type::In ? t.from.toPointer() : nullptr;
+    to[row] = t.type != Transaction::Type::Out ? t.to.toPointer() : nullptr;
+    cents[row] = t.amount.as_cents();
+}
+
+static size_t lowBit(size_t i)
+{
+    return i & (~i + 1);
+}
+
+void CategoryTotals::Series::add(qint64 day, const Cell &delta)
+{
+    const auto it = std::lower_bound(days.begin(), days.end(), day);
+    const size_t pos = static_cast<size_t>(it - days.begin());
+
+    if(it != days.end() && *it == day) {
+        cells[pos] += delta;
+        for(size_t i = pos+1; i<=tree.size(); i += lowBit(i)) {
+            tree[i-1] += delta;
+        }
+        return;
+    }
+
+    if(it == days.end()) {
+        // appending keeps the tree, only the new node is computed
+        const size_t i = days.size() + 1;
+        Cell node = delta;
+        node += sum(i-1) - sum(i - lowBit(i));
+
+        days.push_back(day);
+        cells.push_back(delta);
+        tree.push_back(node);
+        return;
+    }
+
+    days.insert(it, day);
+    cells.insert(std::next(cells.begin(), static_cast<std::ptrdiff_t>(pos)), delta);
+    rebuildTree();
+}
+
+CategoryTotals::Cell CategoryTotals::Series::sum(size_t end) const
+{
+    Cell res;
+    for(size_t i = end; i>0; i -= lowBit(i)) {
+        res += tree[i-1];
+    }
+    return res;
+}
+
+std::pair<size_t, size_t> CategoryTotals::Series::range(const QDate &from, const QDate &to) const
+{
+    const auto first = std::lower_bound(days.begin(), days.end(), from.toJulianDay());
+    const auto last = std::upper_bound(first, days.end(), to.toJulianDay());
+    return {static_cast<size_t>(first - days.begin()), static_cast<size_t>(last - days.begin())};
+}
+
+void CategoryTotals::Series::rebuildTree()
+{
+    tree = cells;
+    for(size_t i = 1; i<=tree.size(); ++i) {
+        const size_t parent = i + lowBit(i);
+        if(parent <= tree.size()) {
+            tree[parent-1] += tree[i-1];
+        }
+    }
+}
+
+void CategoryTotals::build(const LogColumns &columns)
+{
+    for(auto &series : m_series) {
+        series.clear();
+    }
+
+    // log is newest first, so walking it backwards mostly appends days
+    for(size_t i = columns.size(); i>0; --i) {
+        const size_t row = i-1;
+        if(columns.types[row] < Transaction::Type::Count) {
+            apply(static_cast<Transaction::Type::t>(columns.types[row]), columns.categories[row], columns.days[row], {columns.cents[row], 1});
+        }
+    }
+}
+
+void CategoryTotals::add(const Transaction &t)
+{
+    if(t.type != Transaction::Type::Transfer) {
+        apply(t.type, t.category.toPointer(), t.date.toJulianDay(), {t.amount.as_cents(), 1});
+    }
+}
+
+void CategoryTotals::subtract(const Transaction &t)
+{
+    if(t.type != Transaction::Type::Transfer) {
+        apply(t.type, t.category.toPointer(), t.date.toJulianDay(), {-t.amount.as_cents(), -1});
+    }
+}
+
+void CategoryTotals::apply(Transaction::Type::t type, const Node<Category> *category, qint64 day, const Cell &delta)
+{
+    if(type >= Transaction::Type::Count) {
+        return;
+    }
+
+    auto &typeSeries = m_series[type];
+    for(const Node<Category> *node = category; node; node = node->parent) {
+        auto it = typeSeries.find(node);
+        if(it == typeSeries.end()) {
+            it = typeSeries.emplace(node, Series()).first;
+        }
+
+        Series &s = it->second;
+        s.add(day, delta);
+
+        // nodes without rows may be removed, their pointers may be reused
+        if(delta.rows < 0 && s.sum(s.days.size()).rows == 0) {
+            typeSeries.erase(it);
+        }
+    }
+}
+
+const CategoryTotals::Series *CategoryTotals::series(const Node<Category> *node, Transaction::Type::t type) const
+{
+    if(type >= Transaction::Type::Count) {
+        return nullptr;
+    }
+
+    const auto &typeSeries = m_series[type];
+    auto it = typeSeries.find(node);
+    return it != typeSeries.end() ? &it->second : nullptr;
+}
+
+Money CategoryTotals::total(const Node<Category> *node, Transaction::Type::t type, const QDate &from, const QDate &to) const
+{
+    const Series *s = series(node, type);
+    if(!s) {
+        return Money();
+    }
+
+    const auto [first, last] = s->range(from, to);
+    return Money(static_cast<intmax_t>((s->sum(last) - s->sum(first)).cents));
+}
+
+void CategoryTotals::aggregate(Transaction::Type::t type, const QDate &from, const QDate &to, CategoryMoneyMap &categories) const
+{
+    if(type >= Transaction::Type::Count) {
+        return;
+    }
+
+    for(const auto &[node, s] : m_series[type]) {
+        const auto [first, last] = s.range(from, to);
+        const Cell cell = s.sum(last) - s.sum(first);
+        if(cell.rows > 0) {
+            categories[node] += Money(static_cast<intmax_t>(cell.cents));
+        }
+    }
+}
+
+void CategoryTotals::forEachDay(const Node<Category> *node, Transaction::Type::t type, const QDate &from, const QDate &to, const std::function<void(const QDate &, const Money &)> &func) const
+{
+    const Series *s = series(node, type);
+    if(!s) {
+        return;
+    }
+
+    const auto [first, last] = s->range(from, to);
+    for(size_t i = first; i<last; ++i) {
+        if(s->cells[i].rows > 0) {
+            func(QDate::fromJulianDay(s->days[i]), Money(static_cast<intmax_t>(s->cells[i].cents)));
+        }
+    }
+}
+
+void LogPostings::build(const LogColumns &columns)
+{
+    m_categories.clear();
+    m_wallets.clear();
+
+    for(size_t row = 0; row<columns.size(); ++row) {
+        if(columns.categories[row]) {
+            m_categories[columns.categories[row]].push_back(row);
+        }
+        if(columns.from[row]) {
+            m_wallets[columns.from[row]].push_back(row);
+        }
+        if(columns.to[row] && columns.to[row] != columns.from[row]) {
+            m_wallets[columns.to[row]].push_back(row);
+        }
+    }
+}
+
+template <class Map>
+static void eraseRow(Map &map, typename Map::key_type node, size_t row)
+{
+    auto it = map.find(node);
+    if(it == map.end()) {
+        return;
+    }
+
+    std::vector<size_t> &rows = it->second;
+    auto pos = std::lower_bound(rows.begin(), rows.end(), row);
+    if(pos != rows.end() && *pos == row) {
+        rows.erase(pos);
+    }
+    if(rows.empty()) {
+        map.erase(it);
+    }
+}
+
+template <class Map>
+static void insertRow(Map &map, typename Map::key_type node, size_t row)
+{
+    std::vector<size_t> &rows = map[node];
+    auto pos = std::lower_bound(rows.begin(), rows.end(), row);
+    if(pos == rows.end() || *pos != row) {
+        rows.insert(pos, row);
+    }
+}
+
+void LogPostings::erase(const LogColumns &columns, size_t row)
+{
+    if(columns.categories[row]) {
+        eraseRow(m_categories, columns.categories[row], row);
+    }
+    if(columns.from[row]) {
+        eraseRow(m_wallets, columns.from[row], row);
+    }
+    if(columns.to[row]) {
+        eraseRow(m_wallets, columns.to[row], row);
+    }
+}
+
+void LogPostings::insert(const LogColumns &columns, size_t row)
+{
+    if(columns.categories[row]) {
+        insertRow(m_categories, columns.categories[row], row);
+    }
+    if(columns.from[row]) {
+        insertRow(m_wallets, columns.from[row], row);
+    }
+    if(columns.to[row]) {
+        insertRow(m_wallets, columns.to[row], row);
+    }
+}
+
+template <class Map>
+static const std::vector<size_t> &postedRows(const Map &map, typename Map::key_type node)
+{
+    static const std::vector<size_t> empty;
+
+    auto it = map.find(node);
+    return it == map.end() ? empty : it->second;
+}
+
+const std::vector<size_t> &LogPostings::rows(const Node<Category> *node) const
+{
+    return postedRows(m_categories, node);
+}
+
+const std::vector<size_t> &LogPostings::rows(const Node<Wallet> *node) const
+{
+    return postedRows(m_wallets, node);
+}
+
 void CategoryMoneyMap::propagateMoney(const Node<Category> *node, const Money &amount) {
     while(node) {
         (*this)[node] += amount;
@@ -243,11 +594,7 @@ void CategoryMoneyMap::propagateMoney(const Node<Category> *node, const Money &a
 
 void LogData::insertRow(int position)
 {
-    Transaction t;
-    t.date = Today;
-    log.insert(std::next(log.begin(), position), 1, t);
-    ++unanchored;
-    changedMonths.insert(Month(t.date));
+    insertRows(position, 1);
 }
 
 void LogData::insertRows(int position, size_t rows)
@@ -255,8 +602,28 @@ void LogData::insertRows(int position, size_t rows)
     Transaction t;
     t.date = Today;
     log.insert(std::next(log.begin(), position), static_cast<size_t>(rows), t);
+    insertMonthRanges(static_cast<size_t>(position), rows);
+    invalidateColumns();
     unanchored += static_cast<int>(rows);
-    changedMonths.insert(Month(t.date));
+    markMonthChanged(Month(t.date));
+    setChanged();
+
+    for(size_t i = 0; i<rows; ++i) {
+        aggregates.inserted(t);
+    }
+}
+
+void LogData::removeRows(size_t position, size_t rows)
+{
+    for(size_t i = position; i<position + rows; ++i) {
+        markMonthChanged(Month(log[i].date));
+        aggregates.removed(log[i]);
+    }
+
+    const auto first = std::next(log.begin(), static_cast<std::ptrdiff_t>(position));
+    log.erase(first, std::next(first, static_cast<std::ptrdiff_t>(rows)));
+    removeMonthRanges(position, rows);
+    invalidateColumns();
     setChanged();
 }
 
@@ -311,7 +678,7 @@ bool LogData::anchoreTransactions()
 
     for(int i = unanchored-1; i>=0; --i) {
         Transaction &t = log[static_cast<size_t>(i)];
-        if(t.note.startsWith('*')) {
+        if(t.note.get().startsWith('*')) {
             t.note.clear();
         }
 
@@ -320,18 +687,6 @@ bool LogData::anchoreTransactions()
             if(w) {
                 w->data.amount -= t.amount;
             }
-            if(t.type == Transaction::Type::Out) {
-                Month month(t.date);
-                statistics.brief[month].common.spent += t.amount;
-
-                const auto &archNode = t.category;
-                if(archNode.isValidPointer()) {
-                    const Node<Category> *category = archNode.toPointer();
-                    if(category && category->data.regular) {
-                        statistics.brief[month].regular.spent += t.amount;
-                    }
-                }
-            }
         }
 
         if(t.type != Transaction::Type::Out && t.to.isValidPointer()) {
@@ -339,18 +694,6 @@ bool LogData::anchoreTransactions()
             if(w) {
                 w->data.amount += t.amount;
             }
-            if(t.type == Transaction::Type::In) {
-                Month month(t.date);
-                statistics.brief[month].common.received += t.amount;
-
-                const auto &archNode = t.category;
-                if(archNode.isValidPointer()) {
-                    const Node<Category> *category = archNode.toPointer();
-                    if(category && category->data.regular) {
-                        statistics.brief[month].regular.received += t.amount;
-                    }
-                }
-            }
         }
     }
 
@@ -366,84 +709,277 @@ void LogData::appendTransactions(const std::vector<Transaction> &transactions)
         return;
     }
     QDate date = transactions.front().date;
-    changedMonths.insert(Month(date));
+    markMonthChanged(Month(date));
     setChanged();
 
     for(const auto &t : transactions) {
         log.push_front(t);
+        aggregates.inserted(t);
     }
+    insertMonthRanges(0, transactions.size());
+    invalidateColumns();
 
     unanchored += static_cast<int>(transactions.size());
 }
 
-void LogData::updateNote(size_t row, const QString &note)
+void LogData::appendMonthLog(MonthLog &&monthLog)
 {
-    Transaction &t = log[row];
-    t.note = note;
-
-    changedMonths.insert(Month(t.date));
-    setChanged();
+    CASHBOOK_TRACE_SCOPE("appendMonthLog");
+    statistics.brief.merge(monthLog.brief);
+
+    auto &transactions = monthLog.transactions;
+    const size_t position = log.size();
+    log.insert(log.end(), std::make_move_iterator(transactions.begin()), std::make_move_iterator(transactions.end()));
+    insertMonthRanges(position, transactions.size());
+    invalidateColumns();
+    invalidateTotals();
 }
 
-static bool isNodeBelongsTo(const Node<Category> *node, const Node<Category> *parent) {
-    while(node) {
-        if(node == parent) {
-            return true;
-        }
-        node = node->parent;
+const std::vector<LogData::MonthRange> &LogData::monthRanges(const Month &month) const
+{
+    static const std::vector<MonthRange> noRanges;
+
+    if(!m_monthRangesValid) {
+        rebuildMonthRanges();
     }
 
-    return false;
+    auto it = m_monthRanges.find(month);
+    return it != m_monthRanges.end() ? it->second : noRanges;
 }
 
-void LogData::updateTask(Task &task) const
+void LogData::rebuildMonthRanges() const
 {
-    task.spent = 0;
-    task.rest = 0;
+    m_monthRanges.clear();
 
-    if(log.empty()) {
-        task.rest = task.amount;
-        return;
+    size_t begin = 0;
+    while(begin < log.size()) {
+        const Month month(log[begin].date);
+
+        size_t end = begin + 1;
+        while(end < log.size() && Month(log[end].date) == month) {
+            ++end;
+        }
+
+        m_monthRanges[month].emplace_back(begin, end);
+        begin = end;
     }
 
-    const QDate &logBegin = log.at(log.size()-1).date;
-    const QDate &logEnd = log.at(0).date;
+    m_monthRangesValid = true;
+}
 
-    if(task.to < logBegin || task.from > logEnd) {
-        task.rest = task.amount;
+void LogData::insertMonthRanges(size_t position, size_t rows)
+{
+    if(!m_monthRangesValid || !rows) {
         return;
     }
 
-    size_t i = 0;
-    while(i < log.size()) {
-        const Transaction &t = log[i++];
+    // ranges after inserted rows move down, a range around them is split
+    for(auto &[month, ranges] : m_monthRanges) {
+        for(size_t i = 0; i<ranges.size(); ++i) {
+            MonthRange &range = ranges[i];
+            if(range.first >= position) {
+                range.first += rows;
+                range.second += rows;
+            } else if(range.second > position) {
+                const MonthRange tail {position + rows, range.second + rows};
+                range.second = position;
+                ++i; // tail is shifted already
+                ranges.insert(std::next(ranges.begin(), static_cast<std::ptrdiff_t>(i)), tail);
+            }
+        }
+    }
 
-        if(task.type != t.type) {
-            continue;
+    size_t begin = position;
+    while(begin < position + rows) {
+        const Month month(log[begin].date);
+
+        size_t end = begin + 1;
+        while(end < position + rows && Month(log[end].date) == month) {
+            ++end;
         }
 
-        if(t.date > task.to) {
-            continue;
+        // joins neighbour ranges of the same month if rows are adjacent
+        std::vector<MonthRange> &ranges = m_monthRanges[month];
+        auto next = std::lower_bound(ranges.begin(), ranges.end(), MonthRange {end, end});
+        const bool joinsPrev = next != ranges.begin() && std::prev(next)->second == begin;
+        const bool joinsNext = next != ranges.end() && next->first == end;
+
+        if(joinsPrev && joinsNext) {
+            std::prev(next)->second = next->second;
+            ranges.erase(next);
+        } else if(joinsPrev) {
+            std::prev(next)->second = end;
+        } else if(joinsNext) {
+            next->first = begin;
+        } else {
+            ranges.insert(next, {begin, end});
         }
 
-        if(t.date < task.from) {
-            break;
+        begin = end;
+    }
+}
+
+void LogData::removeMonthRanges(size_t position, size_t rows)
+{
+    if(!m_monthRangesValid || !rows) {
+        return;
+    }
+
+    // row boundary before removal to the one after it
+    const auto shift = [position, rows](size_t row) {
+        if(row < position) {
+            return row;
         }
+        return row >= position + rows ? row - rows : position;
+    };
+
+    for(auto it = m_monthRanges.begin(); it != m_monthRanges.end(); ) {
+        std::vector<MonthRange> &ranges = it->second;
 
-        const ArchNode<Category> &trArchNode = t.category;
-        const ArchNode<Category> &taskArchNode = task.category;
-        if(trArchNode.isValidPointer() && taskArchNode.isValidPointer()) {
-            const Node<Category> *trNode = trArchNode.toPointer();
-            const Node<Category> *taskNode = taskArchNode.toPointer();
-            if(isNodeBelongsTo(trNode, taskNode)) {
-                task.spent += t.amount;
+        size_t count = 0;
+        for(size_t i = 0; i<ranges.size(); ++i) {
+            const MonthRange range {shift(ranges[i].first), shift(ranges[i].second)};
+            if(range.first == range.second) {
+                continue; // all rows of the range are removed
             }
+
+            if(count && ranges[count-1].second == range.first) {
+                ranges[count-1].second = range.second; // parts around removed rows meet
+            } else {
+                ranges[count++] = range;
+            }
+        }
+        ranges.resize(count);
+
+        it = ranges.empty() ? m_monthRanges.erase(it) : std::next(it);
+    }
+}
+
+const LogColumns &LogData::columns() const
+{
+    if(!m_columnsValid) {
+        CASHBOOK_TRACE_SCOPE("rebuildColumns");
+        m_columns.clear();
+        for(const Transaction &t : log) {
+            m_columns.append(t);
         }
+        m_columnsValid = true;
+    }
+
+    return m_columns;
+}
+
+const CategoryTotals &LogData::categoryTotals() const
+{
+    if(!m_totalsValid) {
+        CASHBOOK_TRACE_SCOPE("rebuildCategoryTotals");
+        m_totals.build(columns());
+        m_totalsValid = true;
+    }
+
+    return m_totals;
+}
+
+const LogPostings &LogData::postings() const
+{
+    if(!m_postingsValid) {
+        CASHBOOK_TRACE_SCOPE("rebuildPostings");
+        m_postings.build(columns());
+        m_postingsValid = true;
+    }
+
+    return m_postings;
+}
+
+void LogData::inserted(const Transaction &t)
+{
+    // row indices are dropped by `LogData` itself, totals follow the rows
+    if(m_totalsValid) {
+        m_totals.add(t);
     }
+}
+
+void LogData::removed(const Transaction &t)
+{
+    if(m_totalsValid) {
+        m_totals.subtract(t);
+    }
+}
+
+void LogData::categoryMoved(const Node<Category> *node)
+{
+    Q_UNUSED(node);
+    invalidateTotals();
+}
+
+void LogData::markMonthChanged(const Month &month)
+{
+    changedMonths.insert(month);
+    normalizedMonths.erase(month);
+}
+
+void LogData::updateRow(size_t row)
+{
+    if(!m_columnsValid) {
+        m_postingsValid = false; // postings are built from columns
+        return;
+    }
+
+    if(m_postingsValid) {
+        m_postings.erase(m_columns, row);
+    }
+
+    m_columns.set(row, log[row]);
+
+    if(m_postingsValid) {
+        m_postings.insert(m_columns, row);
+    }
+}
+
+void LogData::updateNote(size_t row, const QString &note)
+{
+    Transaction &t = log[row];
+    t.note = note;
+
+    markMonthChanged(Month(t.date));
+    setChanged();
+}
+
+bool LogData::isLoadedSince(const QDate &date) const
+{
+    return storedMonths.empty() || storedMonths.front()->month < Month(date);
+}
+
+void LogData::updateTask(Task &task) const
+{
+    CASHBOOK_TRACE_SCOPE("updateTask");
+    task.spent = 0;
+    task.rest = 0;
+
+    if(log.empty()) {
+        task.rest = task.amount;
+        return;
+    }
+
+    const Node<Category> *taskNode = task.category.toPointer();
+    if(!taskNode) {
+        task.rest = task.amount;
+        return;
+    }
+
+    task.spent = categoryTotals().total(taskNode, task.type, task.from, task.to);
 
     task.rest = task.amount - task.spent;
 }
 
+void LogData::aggregateCategories(const QDate &from, const QDate &to, CategoryMoneyMap &inCategories, CategoryMoneyMap &outCategories) const
+{
+    CASHBOOK_TRACE_SCOPE("aggregateCategories");
+    const CategoryTotals &totals = categoryTotals();
+    totals.aggregate(Transaction::Type::In, from, to, inCategories);
+    totals.aggregate(Transaction::Type::Out, from, to, outCategories);
+}
+
 struct Balance
 {
     int sum {0}; // wallet's balance
@@ -453,6 +989,7 @@ struct Balance
 
 bool LogData::normalizeData()
 {
+    CASHBOOK_TRACE_SCOPE("normalizeData");
     if(log.empty()) {
         return false;
     }
@@ -466,6 +1003,12 @@ bool LogData::normalizeData()
     std::vector<std::reference_wrapper<const Transaction>> day; // temp container for every day
 
     const auto processDay = [this, &day, &date, &res]() {
+        // month was normalized before and has not been changed since
+        if(normalizedMonths.count(Month(date))) {
+            res.insert(res.end(), day.begin(), day.end());
+            return;
+        }
+
         std::vector<Transaction> normalizedDay;
         normalizedDay.reserve(day.size());
 
@@ -493,7 +1036,7 @@ bool LogData::normalizeData()
                     iRec.amount += jRec.amount;
                     std::swap(*std::next(day.begin(), static_cast<ptrdiff_t>(j)), day.back());
                     day.pop_back();
-                    changedMonths.insert(Month(iRec.date));
+                    markMonthChanged(Month(iRec.date));
                     setChanged();
                     --j;
                 }
@@ -576,7 +1119,7 @@ bool LogData::normalizeData()
                 goto skipTransferNormalization; // one of rare places, where it is reasonable, i think
             }
 
-            changedMonths.insert(Month(date));
+            markMonthChanged(Month(date));
             setChanged();
 
             // spread balance records between outs and ins depending on sign of wallets' balance
@@ -704,11 +1247,14 @@ bool LogData::normalizeData()
         res.insert(res.end(), normalizedDay.begin(), normalizedDay.end());
     }; // end of processDay
 
+    std::set<Month> months;
+
     for(const auto &record : log)
     {
         if(record.date != date) {
             // process previous day
             processDay();
+            months.insert(Month(date));
             date = record.date;
             day.clear();
         }
@@ -716,10 +1262,15 @@ bool LogData::normalizeData()
         day.push_back(record);
     }
     processDay(); // process last day
+    months.insert(Month(date));
+
+    normalizedMonths.insert(months.begin(), months.end());
 
     bool changed = isChanged();
     if(changed) {
         std::swap(log, res);
+        invalidateIndices();
+        invalidateTotals(); // rows were merged without events
     }
 
     return changed;
@@ -738,19 +1289,19 @@ Data::Data()
         &tasks
     });
 
-    connect(this, &Data::categoriesStatisticsUpdated, [this](){
-        updateTasks();
-    });
+    log.aggregates.add(&briefAggregate);
+    log.aggregates.add(&tasksAggregate);
 }
 
 void Data::onOwnersRemove(QStringList paths)
 {
+    const QSet<QString> names(paths.cbegin(), paths.cend());
     auto nodes = wallets.rootItem->toList();
     for(auto *node : nodes) {
         ArchPointer<Owner> &owner = node->data.info->owner;
         if(owner.isValidPointer()) {
             QString name = *owner.toPointer();
-            if(paths.contains(name)) {
+            if(names.contains(name)) {
                 owner = ArchiveString(name); // invalidate ArchPointer by assigning QString to it.
             }
         }
@@ -758,48 +1309,123 @@ void Data::onOwnersRemove(QStringList paths)
 }
 
 template <class DataType>
-static void invalidateArchNode(ArchNode<DataType> &archNode, const QStringList &paths)
+static QSet<const Node<DataType> *> nodesFromPaths(const TreeData<DataType> &tree, const QStringList &paths)
 {
-    if(archNode.isValidPointer()) {
-        QString path = pathToString(archNode.toPointer());
-        if(paths.contains(path)) {
-            archNode = ArchiveString(path); // invalidate ArchPointer by assigning QString to it.
+    QSet<const Node<DataType> *> res;
+    for(const QString &path : paths) {
+        for(const Node<DataType> *node : tree.nodesFromPath(path)) {
+            res.insert(node);
         }
     }
+
+    return res;
 }
 
-void Data::onInCategoriesRemove(QStringList paths)
+/**
+ * @brief Log rows referencing any of `nodes`, ascending.
+ */
+template <class DataType>
+static std::vector<size_t> rowsOfNodes(const LogData &log, const QSet<const Node<DataType> *> &nodes)
 {
-    for(Transaction &t : log.log) {
-        if(t.type != Transaction::Type::In) {
-            continue;
+    std::vector<size_t> res;
+    for(const Node<DataType> *node : nodes) {
+        const std::vector<size_t> &rows = log.postings().rows(node);
+        res.insert(res.end(), rows.begin(), rows.end());
+    }
+
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+template <class DataType>
+static bool invalidateArchNode(ArchNode<DataType> &archNode, const QSet<const Node<DataType> *> &nodes)
+{
+    if(archNode.isValidPointer() && nodes.contains(archNode.toPointer())) {
+        archNode = ArchiveString(pathToString(archNode.toPointer())); // invalidate ArchPointer by assigning QString to it.
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Archives categories of tasks and plans which are in `nodes`.
+ * @details Tasks with archived category are recalculated, so they do not keep
+ *          pointers to removed nodes.
+ */
+static void archiveTasksAndPlans(TasksData &tasks, PlansData &plans, const LogData &log, const QSet<const Node<Category> *> &nodes)
+{
+    for(TasksListsData *list : {&tasks.active, &tasks.completed}) {
+        for(Task &task : list->tasks) {
+            if(invalidateArchNode(task.category, nodes)) {
+                log.updateTask(task);
+                list->setChanged();
+            }
         }
+    }
 
-        invalidateArchNode(t.category, paths);
+    for(PlansTermData *term : {&plans.shortTerm, &plans.middleTerm, &plans.longTerm}) {
+        for(Plan &plan : term->plans) {
+            if(invalidateArchNode(plan.category, nodes)) {
+                term->setChanged();
+            }
+        }
     }
 }
 
-void Data::onOutCategoriesRemove(QStringList paths)
+void Data::onInCategoriesRemove(QStringList paths)
 {
-    for(Transaction &t : log.log) {
-        if(t.type != Transaction::Type::Out) {
-            continue;
+    const auto nodes = nodesFromPaths(inCategories, paths);
+    for(size_t row : rowsOfNodes(log, nodes)) {
+        Transaction &t = log.log[row];
+        const Transaction before = t;
+        if(invalidateArchNode(t.category, nodes)) {
+            log.updateRow(row);
+            log.markMonthChanged(Month(t.date));
+            log.setChanged();
+            log.aggregates.edited(before, t);
         }
+    }
+    archiveTasksAndPlans(tasks, plans, log, nodes);
+}
 
-        invalidateArchNode(t.category, paths);
+void Data::onOutCategoriesRemove(QStringList paths)
+{
+    const auto nodes = nodesFromPaths(outCategories, paths);
+    for(size_t row : rowsOfNodes(log, nodes)) {
+        Transaction &t = log.log[row];
+        const Transaction before = t;
+        if(invalidateArchNode(t.category, nodes)) {
+            log.updateRow(row);
+            log.markMonthChanged(Month(t.date));
+            log.setChanged();
+            log.aggregates.edited(before, t);
+        }
     }
+    archiveTasksAndPlans(tasks, plans, log, nodes);
 }
 
 void Data::onWalletsRemove(QStringList paths)
 {
-    for(Transaction &t : log.log) {
-        invalidateArchNode(t.from, paths);
-        invalidateArchNode(t.to, paths);
+    const auto nodes = nodesFromPaths(wallets, paths);
+    for(size_t row : rowsOfNodes(log, nodes)) {
+        Transaction &t = log.log[row];
+        const Transaction before = t;
+        const bool from = invalidateArchNode(t.from, nodes);
+        const bool to = invalidateArchNode(t.to, nodes);
+        if(from || to) {
+            log.updateRow(row);
+            log.markMonthChanged(Month(t.date));
+            log.setChanged();
+            log.aggregates.edited(before, t);
+        }
     }
 }
 
 void Data::updateTasks()
 {
+    CASHBOOK_TRACE_SCOPE("updateTasks");
     updateTasks(tasks.active);
     updateTasks(tasks.completed);
 }
@@ -807,7 +1433,10 @@ void Data::updateTasks()
 void Data::updateTasks(TasksListsData &tasksData)
 {
     for(Task &task : tasksData.tasks) {
-        log.updateTask(task);
+        // sums of tasks with months on disk come from the cache until the months are loaded
+        if(log.isLoadedSince(task.from)) {
+            log.updateTask(task);
+        }
     }
 }
 
@@ -822,20 +1451,22 @@ bool Data::anchoreTransactions()
 }
 
 Node<Wallet> *Data::walletFromPath(const QString &path) {
-    return nodeFromPath<Wallet, WalletsData>(wallets, path);
+    return wallets.nodeFromPath(path);
 }
 
 Node<Category> *Data::inCategoryFromPath(const QString &path) {
-    return nodeFromPath<Category, CategoriesData>(inCategories, path);
+    return inCategories.nodeFromPath(path);
 }
 
 Node<Category> *Data::outCategoryFromPath(const QString &path) {
-    return nodeFromPath<Category, CategoriesData>(outCategories, path);
+    return outCategories.nodeFromPath(path);
 }
 
 void Data::clear()
 {
     owners.owners.clear();
+    owners.ids.clear();
+    banks.ids.clear();
 
     if(wallets.rootItem) {
         delete wallets.rootItem;
@@ -852,7 +1483,17 @@ void Data::clear()
     }
     outCategories.rootItem = new Node<Category>;
 
+    wallets.rebuildIndex();
+    inCategories.rebuildIndex();
+    outCategories.rebuildIndex();
+
     log.log.clear();
+    log.invalidateIndices();
+    log.invalidateTotals();
+    log.monthHashes.clear();
+    log.normalizedMonths.clear();
+    log.storedMonths.clear();
+    log.format = LogFormat::Segments;
     plans.shortTerm.plans.clear();
     plans.middleTerm.plans.clear();
     plans.longTerm.plans.clear();
@@ -918,6 +1559,8 @@ void Data::importSerbReceiptFile(QStringView receipt, const Node<Wallet> *wallet
     Transaction t;
     t.from = wallet;
 
+    QString name; // accumulated until price line, then interned as note
+
     std::vector<Transaction> transactions;
 
     while(!lines.front().startsWith(QLatin1String("===="))) {
@@ -928,11 +1571,11 @@ void Data::importSerbReceiptFile(QStringView receipt, const Node<Wallet> *wallet
             priceStr = priceStr.mid(priceStr.lastIndexOf(' ') + 1);
             t.amount = Money( priceStr.toString().replace(',', '.').toDouble() );
 
-            t.note = "*" + t.note.trimmed();
+            t.note = "*" + name.trimmed();
             transactions.push_back(t);
-            t.note = "";
+            name.clear();
         } else {
-            t.note += lines.front().toString();
+            name += lines.front().toString();
         }
 
         lines.pop_front();
@@ -4,6 +4,10 @@
 #include "basic_types.h"
 #include <set>
 #include <deque>
+#include <optional>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
 
 namespace cashbook
 {
@@ -142,6 +146,12 @@ struct Wallet : public Idable
     Type::t type {Type::Common};
     QString name;
     Money amount;
+    TreeInterval interval; // see `TreeData::renumber()`
+    PathCache paths;
+
+    // cache of `WalletsData::treeAmount()`
+    mutable Money treeAmount;
+    mutable bool treeAmountValid {false};
 
     std::shared_ptr<Info> info {std::make_shared<Info>()};
 };
@@ -149,6 +159,8 @@ struct Wallet : public Idable
 struct Category : public IdableString
 {
     bool regular {false};
+    TreeInterval interval; // see `TreeData::renumber()`
+    PathCache paths;
 
     Category() : IdableString() {}
     Category(const char *str) : IdableString(str) {}
@@ -181,7 +193,7 @@ struct Transaction
     };
 
     QDate date;
-    QString note;
+    PooledString note;
     Type::t type {Type::Out};
     ArchNode<Category> category;
     Money amount;
@@ -227,7 +239,56 @@ struct BriefStatisticsRecord
 };
 
 class BriefStatistics : public std::map<Month, BriefStatisticsRecord, std::greater<Month>>
-{};
+{
+public:
+    void add(const Transaction &t);
+    void subtract(const Transaction &t);
+    void merge(const BriefStatistics &other);
+
+private:
+    void apply(const Transaction &t, bool subtract);
+};
+
+/**
+ * @brief Transactions of a single month file.
+ * @details Month files are parsed independently from each other, so every
+ *          file produces its own portion of brief statistics which is merged
+ *          into `Statistics::brief` when the month is appended to the log.
+ */
+struct MonthLog
+{
+    void append(Transaction &&t) {
+        brief.add(t);
+        transactions.emplace_back(std::move(t));
+    }
+
+    std::vector<Transaction> transactions;
+    BriefStatistics brief;
+};
+
+/**
+ * @brief Columnar copy of `LogData::log` for full-history scans.
+ * @details Keeps only fields analytics need, each in its own contiguous
+ *          array. Row `i` of every column is `log[i]`. Dates are julian days,
+ *          archived references are `nullptr`.
+ */
+struct LogColumns
+{
+    void clear();
+    void append(const Transaction &t);
+    void set(size_t row, const Transaction &t);
+
+    size_t size() const {
+        return days.size();
+    }
+
+    std::vector<qint64> days;
+    std::vector<quint8> types;
+    std::vector<const Node<Category> *> categories;
+    std::vector<const Node<Wallet> *> from;
+    std::vector<const Node<Wallet> *> to;
+    std::vector<qint64> cents;
+};
 
 class CategoryMoneyMap : public std::map<const Node<Category> *, Money>
 {
@@ -235,10 +296,162 @@ public:
     void propagateMoney(const Node<Category> *node, const Money &amount);
 };
 
+/**
+ * @brief Per-category day totals of the log.
+ * @details For every category and transaction type keeps days on which its
+ *          subtree had transactions, ascending, and a Fenwick tree of totals
+ *          over them. Period total of a category is two binary searches and
+ *          two prefix sums, no matter how long the log is. Rows are added and
+ *          subtracted in place, so edits do not need a rebuild.
+ */
+class CategoryTotals
+{
+public:
+    void build(const LogColumns &columns);
+    void add(const Transaction &t);
+    void subtract(const Transaction &t);
+
+    Money total(const Node<Category> *node, Transaction::Type::t type, const QDate &from, const QDate &to) const;
+
+    /**
+     * Fills `categories` with `[from, to]` totals of every category that had
+     * transactions of `type` in that period.
+     */
+    void aggregate(Transaction::Type::t type, const QDate &from, const QDate &to, CategoryMoneyMap &categories) const;
+
+    /**
+     * Calls `func(day, amount)` for every day of `[from, to]` on which subtree
+     * of `node` had transactions of `type`.
+     */
+    void forEachDay(const Node<Category> *node, Transaction::Type::t type, const QDate &from, const QDate &to, const std::function<void(const QDate &, const Money &)> &func) const;
+
+private:
+    struct Cell
+    {
+        qint64 cents {0};
+        qint64 rows {0};
+
+        Cell &operator +=(const Cell &other) {
+            cents += other.cents;
+            rows += other.rows;
+            return *this;
+        }
+
+        Cell operator -(const Cell &other) const {
+            return {cents - other.cents, rows - other.rows};
+        }
+    };
+
+    struct Series
+    {
+        std::vector<qint64> days; // julian days, ascending
+        std::vector<Cell> cells;  // totals of `days`
+        std::vector<Cell> tree;   // Fenwick tree over `cells`
+
+        void add(qint64 day, const Cell &delta);
+        Cell sum(size_t end) const; // total of `cells[0, end)`
+        std::pair<size_t, size_t> range(const QDate &from, const QDate &to) const;
+
+    private:
+        void rebuildTree();
+    };
+
+    void apply(Transaction::Type::t type, const Node<Category> *category, qint64 day, const Cell &delta);
+    const Series *series(const Node<Category> *node, Transaction::Type::t type) const;
+
+    std::array<std::unordered_map<const Node<Category> *, Series>, Transaction::Type::Count> m_series;
+};
+
+/**
+ * @brief Rows of the log referencing each category and wallet.
+ * @details Built from `LogColumns`, rows of every node are ascending.
+ *          Archived references are not indexed.
+ */
+class LogPostings
+{
+public:
+    void build(const LogColumns &columns);
+
+    /**
+     * Removes `row` from lists of nodes which `columns` reference in it, or
+     * adds it to them. Edited row is erased before columns are updated and
+     * inserted after that.
+     */
+    void erase(const LogColumns &columns, size_t row);
+    void insert(const LogColumns &columns, size_t row);
+
+    const std::vector<size_t> &rows(const Node<Category> *node) const;
+    const std::vector<size_t> &rows(const Node<Wallet> *node) const;
+
+private:
+    std::unordered_map<const Node<Category> *, std::vector<size_t>> m_categories;
+    std::unordered_map<const Node<Wallet> *, std::vector<size_t>> m_wallets;
+};
+
 struct Statistics {
     BriefStatistics brief;
 };
 
+/**
+ * @brief Value derived from the log which is kept up to date by deltas.
+ */
+class LogAggregate
+{
+public:
+    virtual ~LogAggregate() {}
+
+    virtual void inserted(const Transaction &t) = 0;
+    virtual void removed(const Transaction &t) = 0;
+
+    /**
+     * `node` category got another parent.
+     */
+    virtual void categoryMoved(const Node<Category> *node) = 0;
+};
+
+/**
+ * @brief Dispatches log mutation events to registered aggregates.
+ * @details Anyone who inserts, removes or edits log rows or moves category
+ *          nodes reports it here, so aggregates never rescan the log. Edit
+ *          is reported as removal of the old row and insertion of the new one.
+ *          Aggregates are notified in registration order.
+ */
+class AggregateEngine
+{
+public:
+    void add(LogAggregate *aggregate) {
+        m_aggregates.push_back(aggregate);
+    }
+
+    void inserted(const Transaction &t);
+    void removed(const Transaction &t);
+    void edited(const Transaction &before, const Transaction &after);
+    void categoryMoved(const Node<Category> *node);
+
+private:
+    std::vector<LogAggregate *> m_aggregates;
+};
+
+/**
+ * @brief Keeps `Statistics::brief` in sync with the log.
+ * @details Brief counts every row of the log, anchored or not, the same way
+ *          it is counted when months are loaded.
+ */
+class BriefAggregate : public LogAggregate
+{
+public:
+    BriefAggregate(BriefStatistics &brief)
+        : m_brief(brief)
+    {}
+
+    void inserted(const Transaction &t) override;
+    void removed(const Transaction &t) override;
+    void categoryMoved(const Node<Category> *node) override;
+
+private:
+    BriefStatistics &m_brief;
+};
+
 struct PlanTerm {
     enum t {
         Short = 0,
@@ -265,55 +478,316 @@ struct TaskStatus {
 class OwnersData : public Changable
 {
 public:
+    void rebuildIndex() {
+        ids.clear();
+        for(const Owner &owner : owners) {
+            ids.insert(owner.id, &owner);
+        }
+    }
 
     QVector<Owner> owners;
+    IdIndex<Owner> ids;
 };
 
 class BanksData : public Changable
 {
 public:
+    void rebuildIndex() {
+        ids.clear();
+        for(const Bank &bank : banks) {
+            ids.insert(bank.id, &bank);
+        }
+    }
 
     QVector<Bank> banks;
+    IdIndex<Bank> ids;
 };
 
-class WalletsData : public Changable
+/**
+ * @brief Common data of wallets and categories trees.
+ * @details Keeps index of tree nodes by their ids and pre-order intervals of
+ *          nodes. Both should be updated by anyone who adds nodes to the tree,
+ *          removes them from it or moves them within it. Index of nodes by
+ *          their paths follows them: it is dropped by `renumber()` and by
+ *          `PathCache::invalidateAll()`.
+ */
+template <class T>
+class TreeData : public Changable
 {
 public:
+    void indexSubtree(const Node<T> *node) {
+        ids.insert(node->data.id, node);
+        for(const Node<T> *child : node->children) {
+            indexSubtree(child);
+        }
+    }
+
+    void unindexSubtree(const Node<T> *node) {
+        ids.remove(node->data.id);
+        for(const Node<T> *child : node->children) {
+            unindexSubtree(child);
+        }
+    }
+
+    void rebuildIndex() {
+        ids.clear();
+        for(const Node<T> *child : rootItem->children) {
+            indexSubtree(child);
+        }
+        renumber();
+    }
+
+    /**
+     * @brief Assigns fresh `TreeInterval`s to all nodes.
+     */
+    void renumber() {
+        if(!rootItem) {
+            return;
+        }
+
+        qint64 next = TreeInterval::reserve(subtreeSize(rootItem));
+        renumberSubtree(rootItem, next);
+        m_pathsGeneration = 0;
+    }
+
+    /**
+     * @brief Nodes with given path (see `pathToString()`) in pre-order.
+     * @details Several nodes share a path if siblings have equal names.
+     *          Index is rebuilt lazily after the tree is changed.
+     */
+    const std::vector<Node<T> *> &nodesFromPath(const QString &path) const {
+        static const std::vector<Node<T> *> empty;
+
+        if(m_pathsGeneration != PathCache::current()) {
+            m_paths.clear();
+            if(rootItem) {
+                indexPaths(rootItem);
+            }
+            m_pathsGeneration = PathCache::current();
+        }
+
+        auto it = m_paths.constFind(path);
+        return it == m_paths.cend() ? empty : *it;
+    }
+
+    Node<T> *nodeFromPath(const QString &path) const {
+        const auto &nodes = nodesFromPath(path);
+        return nodes.empty() ? nullptr : nodes.front();
+    }
+
+    Tree<T> *rootItem {nullptr};
+    IdIndex<Node<T>> ids;
 
-    Tree<Wallet> *rootItem {nullptr};
+private:
+    void indexPaths(Node<T> *node) const {
+        for(Node<T> *child : node->children) {
+            m_paths[pathToString(child)].push_back(child);
+            indexPaths(child);
+        }
+    }
+
+    mutable QHash<QString, std::vector<Node<T> *>> m_paths;
+    mutable quint64 m_pathsGeneration {0};
+
+    static qint64 subtreeSize(const Node<T> *node) {
+        qint64 size = 1;
+        for(const Node<T> *child : node->children) {
+            size += subtreeSize(child);
+        }
+        return size;
+    }
+
+    static void renumberSubtree(Node<T> *node, qint64 &next) {
+        node->data.interval.begin = next++;
+        for(Node<T> *child : node->children) {
+            renumberSubtree(child, next);
+        }
+        node->data.interval.end = next;
+    }
 };
 
-class CategoriesData : public Changable
+/**
+ * @brief Whether `node` is `parent` or one of its descendants.
+ */
+template <class T>
+bool isNodeBelongsTo(const Node<T> *node, const Node<T> *parent)
+{
+    return node && parent && parent->data.interval.contains(node->data.interval);
+}
+
+class WalletsData : public TreeData<Wallet>
 {
 public:
+    /**
+     * @brief Sum of leaf amounts in subtree of `node`.
+     * @details Sums are cached on nodes. Anyone who changes amount of a wallet
+     *          or shape of the tree should invalidate it.
+     */
+    Money treeAmount(const Node<Wallet> *node) const;
+
+    /**
+     * Drops cached sums of `node` and all its ancestors. Returns them,
+     * nearest first.
+     */
+    std::vector<const Node<Wallet> *> invalidateTreeAmount(const Node<Wallet> *node);
+};
 
-    Tree<Category> *rootItem {nullptr};
+class CategoriesData : public TreeData<Category>
+{
 };
 
-class LogData : public Changable
+/**
+ * @brief How months of the log are stored on disk.
+ */
+enum class LogFormat {
+    Yaml,     // `.pitm` files only
+    Segments, // binary month segments along with `.pitm` files
+
+    Count
+};
+
+/**
+ * @brief Month of the log which is not loaded yet.
+ * @details `read()` only reads and parses month's file, so it may be called
+ *          from a worker thread. `take()` resolves references against
+ *          current wallets and categories and is called from the main thread.
+ */
+class StoredMonth
+{
+public:
+    StoredMonth(const Month &month)
+        : month(month)
+    {}
+
+    virtual ~StoredMonth() {}
+
+    virtual void read() = 0;
+    virtual MonthLog take() = 0;
+
+    const Month month;
+    std::optional<BriefStatistics> brief; // known without loading, already merged into `Statistics::brief`
+};
+
+class LogData : public Changable, public LogAggregate
 {
 public:
 
     LogData(Statistics &statistics)
         : statistics(statistics)
-    {}
+    {
+        aggregates.add(this);
+    }
 
     void insertRow(int position);
     void insertRows(int position, size_t rows);
+    void removeRows(size_t position, size_t rows);
     bool copyTop();
 
     bool canAnchore() const;
     bool anchoreTransactions();
     void appendTransactions(const std::vector<Transaction> &transactions);
+    void appendMonthLog(MonthLog &&monthLog);
 
+    void markMonthChanged(const Month &month);
+    void updateRow(size_t row);
     void updateNote(size_t row, const QString &note);
     void updateTask(Task &task) const;
+
+    /**
+     * Whether every month from `date` on is loaded, so sums over the log are
+     * complete for periods starting at `date`.
+     */
+    bool isLoadedSince(const QDate &date) const;
+
+    /**
+     * Sums transactions of `[from, to]` period by categories. Money of a
+     * category includes money of all its descendants.
+     */
+    void aggregateCategories(const QDate &from, const QDate &to, CategoryMoneyMap &inCategories, CategoryMoneyMap &outCategories) const;
     bool normalizeData();
 
+    /**
+     * @brief `[begin, end)` rows of `log` with transactions of a single month.
+     * @details Log is sorted newest first, so a month is usually a single
+     *          range. Unanchored rows may break the order until they are
+     *          normalized. Built on the first query, then inserted and removed
+     *          rows shift and merge ranges in place.
+     */
+    using MonthRange = std::pair<size_t, size_t>;
+    const std::vector<MonthRange> &monthRanges(const Month &month) const;
+
+    /**
+     * @brief Columnar copy of `log`.
+     * @details Cell edits patch it through `updateRow()`.
+     */
+    const LogColumns &columns() const;
+
+    /**
+     * @brief Period totals by categories, built from `columns()`.
+     * @details Once built, totals follow row events of `aggregates`. They are
+     *          dropped only when rows change without events (history fetch,
+     *          normalization) or categories are moved.
+     */
+    const CategoryTotals &categoryTotals() const;
+
+    /**
+     * @brief Rows by categories and wallets, built from `columns()`.
+     * @details Dropped together with columns.
+     */
+    const LogPostings &postings() const;
+
+    /**
+     * Row indices (`monthRanges()`, `columns()`, `postings()`) are rebuilt
+     * lazily. `insertRows()`, `removeRows()`, `appendTransactions()` and
+     * `appendMonthLog()` keep month ranges by themselves. Anyone else who
+     * inserts, removes or moves rows or changes their dates should invalidate
+     * indices. Other edits of a row call `updateRow()`.
+     */
+    void invalidateIndices() {
+        m_monthRangesValid = false;
+        invalidateColumns();
+    }
+
+    /**
+     * Drops `categoryTotals()`, for rows changed without events.
+     */
+    void invalidateTotals() {
+        m_totalsValid = false;
+    }
+
+    void inserted(const Transaction &t) override;
+    void removed(const Transaction &t) override;
+    void categoryMoved(const Node<Category> *node) override;
+
     std::deque<Transaction> log;
+    AggregateEngine aggregates; // row indices above are registered first
     Statistics &statistics;
     int unanchored {0};
     std::set<Month> changedMonths;
+    std::map<Month, quint64> monthHashes; // hashes of month files as they were last saved
+    std::set<Month> normalizedMonths; // months which `normalizeData()` would not change
+    std::deque<std::unique_ptr<StoredMonth>> storedMonths; // months older than `log`, newest first
+    LogFormat format {LogFormat::Segments}; // kept in the head file
+
+private:
+    void rebuildMonthRanges() const;
+    void insertMonthRanges(size_t position, size_t rows);
+    void removeMonthRanges(size_t position, size_t rows);
+
+    // columns and postings are positional, any inserted or removed row drops them
+    void invalidateColumns() {
+        m_columnsValid = false;
+        m_postingsValid = false;
+    }
+
+    mutable std::map<Month, std::vector<MonthRange>> m_monthRanges;
+    mutable bool m_monthRangesValid {false};
+    mutable LogColumns m_columns;
+    mutable bool m_columnsValid {false};
+    mutable CategoryTotals m_totals;
+    mutable bool m_totalsValid {false};
+    mutable LogPostings m_postings;
+    mutable bool m_postingsValid {false};
 };
 
 class PlansTermData : public Changable
@@ -362,6 +836,30 @@ public:
     TasksListsData completed;
 };
 
+/**
+ * @brief Keeps `Task::spent` and `Task::rest` in sync with the log.
+ * @details Tasks are recalculated entirely only when category tree changes
+ *          its shape or when tasks themselves are edited.
+ */
+class TasksAggregate : public LogAggregate
+{
+public:
+    TasksAggregate(TasksData &tasks, const LogData &log)
+        : m_tasks(tasks)
+        , m_log(log)
+    {}
+
+    void inserted(const Transaction &t) override;
+    void removed(const Transaction &t) override;
+    void categoryMoved(const Node<Category> *node) override;
+
+private:
+    void apply(const Transaction &t, bool subtract);
+
+    TasksData &m_tasks;
+    const LogData &m_log;
+};
+
 class Data : public QObject, public ChangeObservable
 {
     Q_OBJECT
@@ -379,6 +877,9 @@ public:
 
     Statistics statistics;
 
+    BriefAggregate briefAggregate {statistics.brief};
+    TasksAggregate tasksAggregate {tasks, log};
+
     Node<Wallet> *walletFromPath(const QString &path);
     Node<Category> *inCategoryFromPath(const QString &path);
     Node<Category> *outCategoryFromPath(const QString &path);
@@ -398,30 +899,7 @@ public:
 signals:
     void categoriesStatisticsUpdated();
 
-private:
-    template<class T, class Model>
-    Node<T> *nodeFromPath(const Model &model, const QString &path);
-};
-
-template<class T, class Model>
-Node<T> *Data::nodeFromPath(const Model &model, const QString &path) {
-    QStringList l = path.split(pathConcat, Qt::KeepEmptyParts);
-    Node<T> *node = model.rootItem;
-    for(const auto &s : l) {
-        bool found = false;
-        for(const auto &child : node->children) {
-            if(extractPathString(child) == s) {
-                node = child;
-                found = true;
-                break;
-            }
-        }
-        if(!found) {
-            return nullptr;
-        }
-    }
-    return node;
-}
+};
 
 } // namespace cashbook
 
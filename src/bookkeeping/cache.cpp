@@ -0,0 +1,242 @@
+#include "cache.h"
+#include "bookkeeping/codecs.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+
+namespace cashbook
+{
+
+namespace cache
+{
+
+static const quint32 Magic {0x50434348}; // "PCCH"
+static const quint32 Version {1};
+
+FileStamp stamp(const QFileInfo &file)
+{
+    if(!file.exists()) {
+        return {};
+    }
+
+    return {file.lastModified().toMSecsSinceEpoch(), file.size()};
+}
+
+//
+// Keys
+//
+
+template <class T>
+static quint64 hashValue(const T &value, quint64 seed)
+{
+    return codecs::hash(std::string_view(reinterpret_cast<const char *>(&value), sizeof(value)), seed);
+}
+
+static quint64 hashNode(const Wallet &wallet, quint64 seed)
+{
+    return codecs::hash(codecs::toStringView(wallet.id.toRfc4122()), seed);
+}
+
+static quint64 hashNode(const Category &category, quint64 seed)
+{
+    seed = codecs::hash(codecs::toStringView(category.id.toRfc4122()), seed);
+    return hashValue(category.regular, seed);
+}
+
+template <class T>
+static quint64 hashChildren(const Node<T> *node, quint64 seed)
+{
+    // root's own data is not stored, so only its children are hashed
+    seed = hashValue(static_cast<quint64>(node->childCount()), seed);
+    for(const auto &child : node->children) {
+        seed = hashChildren(child, hashNode(child->data, seed));
+    }
+
+    return seed;
+}
+
+quint64 treesHash(const Data &data)
+{
+    quint64 res {codecs::HashSeed};
+    res = hashChildren(data.wallets.rootItem, res);
+    res = hashChildren(data.inCategories.rootItem, res);
+    res = hashChildren(data.outCategories.rootItem, res);
+    return res;
+}
+
+TaskEntry taskEntry(const Task &task)
+{
+    TaskEntry entry;
+    entry.type = task.type;
+    entry.from = task.from;
+    entry.to = task.to;
+    entry.spent = task.spent;
+
+    if(task.category.isValidPointer()) {
+        const Node<Category> *node = task.category.toPointer();
+        entry.category = node ? codecs::toQString(codecs::formatUuid(node->data.id)) : QString();
+    } else {
+        entry.category = task.category.toString();
+    }
+
+    return entry;
+}
+
+const TaskEntry *Snapshot::findTask(const Task &task) const
+{
+    const TaskEntry key {taskEntry(task)};
+
+    for(const TaskEntry &entry : tasks) {
+        if(entry.type == key.type && entry.category == key.category && entry.from == key.from && entry.to == key.to) {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+//
+// Stream
+//
+
+static QDataStream &operator<<(QDataStream &out, const Money &money)
+{
+    return out << static_cast<qint64>(money.as_cents());
+}
+
+static QDataStream &operator>>(QDataStream &in, Money &money)
+{
+    qint64 cents {0};
+    in >> cents;
+    money = Money(static_cast<intmax_t>(cents));
+    return in;
+}
+
+static QDataStream &operator<<(QDataStream &out, const Month &month)
+{
+    return out << static_cast<qint32>(month.year) << static_cast<qint32>(month.month);
+}
+
+static QDataStream &operator>>(QDataStream &in, Month &month)
+{
+    qint32 year {0};
+    qint32 number {0};
+    in >> year >> number;
+    month.year = year;
+    month.month = number;
+    return in;
+}
+
+static QDataStream &operator<<(QDataStream &out, const FileStamp &stamp)
+{
+    return out << stamp.modified << stamp.size;
+}
+
+static QDataStream &operator>>(QDataStream &in, FileStamp &stamp)
+{
+    return in >> stamp.modified >> stamp.size;
+}
+
+static QDataStream &operator<<(QDataStream &out, const BriefStatistics &brief)
+{
+    out << static_cast<quint32>(brief.size());
+    for(const auto &[month, record] : brief) {
+        out << month
+            << record.common.spent << record.common.received
+            << record.regular.spent << record.regular.received;
+    }
+    return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, BriefStatistics &brief)
+{
+    quint32 count {0};
+    in >> count;
+    for(quint32 i = 0; i<count && in.status() == QDataStream::Ok; ++i) {
+        Month month;
+        BriefStatisticsRecord record;
+        in >> month
+           >> record.common.spent >> record.common.received
+           >> record.regular.spent >> record.regular.received;
+        brief[month] = record;
+    }
+    return in;
+}
+
+bool load(Snapshot &snapshot, const QString &fileName)
+{
+    snapshot = Snapshot();
+
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic {0};
+    quint32 version {0};
+    in >> magic >> version;
+    if(magic != Magic || version != Version) {
+        return false;
+    }
+
+    in >> snapshot.trees;
+
+    quint32 months {0};
+    in >> months;
+    for(quint32 i = 0; i<months && in.status() == QDataStream::Ok; ++i) {
+        Month month;
+        MonthEntry entry;
+        in >> month >> entry.yaml >> entry.segment >> entry.brief >> entry.normalized;
+        snapshot.months.emplace(month, std::move(entry));
+    }
+
+    quint32 tasks {0};
+    in >> tasks;
+    for(quint32 i = 0; i<tasks && in.status() == QDataStream::Ok; ++i) {
+        TaskEntry entry;
+        quint8 type {0};
+        in >> type >> entry.category >> entry.from >> entry.to >> entry.spent;
+        entry.type = type < Transaction::Type::Count ? static_cast<Transaction::Type::t>(type) : Transaction::Type::Out;
+        snapshot.tasks.push_back(std::move(entry));
+    }
+
+    if(in.status() != QDataStream::Ok) {
+        snapshot = Snapshot();
+        return false;
+    }
+
+    return true;
+}
+
+bool save(const Snapshot &snapshot, const QString &fileName)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    out << Magic << Version << snapshot.trees;
+
+    out << static_cast<quint32>(snapshot.months.size());
+    for(const auto &[month, entry] : snapshot.months) {
+        out << month << entry.yaml << entry.segment << entry.brief << entry.normalized;
+    }
+
+    out << static_cast<quint32>(snapshot.tasks.size());
+    for(const TaskEntry &entry : snapshot.tasks) {
+        out << static_cast<quint8>(entry.type) << entry.category << entry.from << entry.to << entry.spent;
+    }
+
+    return out.status() == QDataStream::Ok;
+}
+
+} // namespace cache
+
+} // namespace cashbook
@@ -0,0 +1,72 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "bookkeeping/bookkeeping.h"
+
+class QFileInfo;
+
+namespace cashbook
+{
+
+/**
+ * @brief Values derived from the log which are kept between runs.
+ * @details Snapshot is written after every save. On load its month entries
+ *          are used only while month files have the same size and
+ *          modification time as they had when the snapshot was written, and
+ *          wallets and categories trees are the same.
+ */
+namespace cache
+{
+
+struct FileStamp
+{
+    qint64 modified {0}; // msecs since epoch
+    qint64 size {-1};    // -1 for a missing file
+
+    bool operator==(const FileStamp &other) const = default;
+};
+
+FileStamp stamp(const QFileInfo &file);
+
+struct MonthEntry
+{
+    FileStamp yaml;
+    FileStamp segment;
+    BriefStatistics brief; // as month file gives it, i.e. `MonthLog::brief`
+    bool normalized {false};
+};
+
+struct TaskEntry
+{
+    Transaction::Type::t type {Transaction::Type::Out};
+    QString category;
+    QDate from;
+    QDate to;
+    Money spent;
+};
+
+struct Snapshot
+{
+    quint64 trees {0};
+    std::map<Month, MonthEntry> months;
+    std::vector<TaskEntry> tasks;
+
+    const TaskEntry *findTask(const Task &task) const;
+};
+
+/**
+ * Hash of wallets and categories trees. Cached values depend on identity of
+ * nodes, their hierarchy and `Category::regular` flags.
+ */
+quint64 treesHash(const Data &data);
+
+TaskEntry taskEntry(const Task &task);
+
+bool load(Snapshot &snapshot, const QString &fileName);
+bool save(const Snapshot &snapshot, const QString &fileName);
+
+} // namespace cache
+
+} // namespace cashbook
+
+#endif // CACHE_H
@@ -0,0 +1,199 @@
+#include "codecs.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+
+namespace cashbook
+{
+
+namespace codecs
+{
+
+static const QString dateFormat {QStringLiteral("dd.MM.yyyy")};
+static constexpr char hexDigits[] {"0123456789abcdef"};
+
+static QString fromUtf8(std::string_view str)
+{
+    return QString::fromUtf8(str.data(), static_cast<qsizetype>(str.size()));
+}
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int hexValue(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+//
+// Dates
+//
+
+QDate parseDate(std::string_view str)
+{
+    const auto number = [&str](size_t pos, size_t count) {
+        int res = 0;
+        for(size_t i = pos; i<pos+count; ++i) {
+            res = res*10 + (str[i] - '0');
+        }
+        return res;
+    };
+
+    bool fixed = str.size() == 10 && str[2] == '.' && str[5] == '.';
+    for(size_t i : {0, 1, 3, 4, 6, 7, 8, 9}) {
+        fixed = fixed && isDigit(str[i]);
+    }
+
+    if(!fixed) {
+        return QDate::fromString(fromUtf8(str), dateFormat);
+    }
+
+    return QDate(number(6, 4), number(3, 2), number(0, 2));
+}
+
+std::string formatDate(const QDate &date)
+{
+    if(!date.isValid()) {
+        return {};
+    }
+
+    const int year = date.year();
+    if(year < 0 || year > 9999) {
+        return date.toString(dateFormat).toStdString();
+    }
+
+    const auto put = [](char *dst, int value, int count) {
+        for(int i = count-1; i>=0; --i) {
+            dst[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    };
+
+    std::string res(10, '.');
+    put(&res[0], date.day(), 2);
+    put(&res[3], date.month(), 2);
+    put(&res[6], year, 4);
+
+    return res;
+}
+
+//
+// Uuids
+//
+
+QUuid parseUuid(std::string_view str)
+{
+    if(str.size() == 38 && str.front() == '{' && str.back() == '}') {
+        str = str.substr(1, 36);
+    }
+
+    // xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx
+    uchar bytes[16];
+    bool ok = str.size() == 36;
+
+    size_t pos = 0;
+    for(size_t b = 0; ok && b<16; ++b) {
+        if(pos == 8 || pos == 13 || pos == 18 || pos == 23) {
+            ok = str[pos] == '-';
+            ++pos;
+        }
+
+        const int hi = ok ? hexValue(str[pos]) : -1;
+        const int lo = ok ? hexValue(str[pos+1]) : -1;
+        ok = hi >= 0 && lo >= 0;
+        bytes[b] = static_cast<uchar>(hi << 4 | lo);
+        pos += 2;
+    }
+
+    if(!ok) {
+        return QUuid(fromUtf8(str));
+    }
+
+    return QUuid::fromRfc4122(QByteArrayView(bytes, sizeof(bytes)));
+}
+
+std::string formatUuid(const QUuid &id)
+{
+    const uchar bytes[16] {
+        static_cast<uchar>(id.data1 >> 24), static_cast<uchar>(id.data1 >> 16),
+        static_cast<uchar>(id.data1 >> 8),  static_cast<uchar>(id.data1),
+        static_cast<uchar>(id.data2 >> 8),  static_cast<uchar>(id.data2),
+        static_cast<uchar>(id.data3 >> 8),  static_cast<uchar>(id.data3),
+        id.data4[0], id.data4[1], id.data4[2], id.data4[3],
+        id.data4[4], id.data4[5], id.data4[6], id.data4[7],
+    };
+
+    std::string res;
+    res.reserve(38);
+    res.push_back('{');
+
+    for(int b = 0; b<16; ++b) {
+        if(b == 4 || b == 6 || b == 8 || b == 10) {
+            res.push_back('-');
+        }
+
+        const uchar byte = bytes[b];
+        res.push_back(hexDigits[byte >> 4]);
+        res.push_back(hexDigits[byte & 0xF]);
+    }
+
+    res.push_back('}');
+    return res;
+}
+
+//
+// Amounts
+//
+
+bool parseCents(std::string_view str, qint64 &cents)
+{
+    const char *begin = str.data();
+    const char *end = begin + str.size();
+
+    // from_chars does not accept explicit plus
+    if(begin != end && *begin == '+') {
+        ++begin;
+    }
+
+    auto [ptr, ec] = std::from_chars(begin, end, cents);
+    if(ec == std::errc() && ptr == end) {
+        return true;
+    }
+
+    const std::string copy(begin, end);
+    char *parsedEnd = nullptr;
+    const double value = std::strtod(copy.c_str(), &parsedEnd);
+    if(copy.empty() || parsedEnd != copy.c_str() + copy.size() || !std::isfinite(value)) {
+        cents = 0;
+        return false;
+    }
+
+    cents = static_cast<qint64>(std::llround(value));
+    return true;
+}
+
+//
+// Hashes
+//
+
+quint64 hash(std::string_view bytes, quint64 seed)
+{
+    quint64 res {seed};
+
+    for(const char c : bytes) {
+        res ^= static_cast<uchar>(c);
+        res *= 1099511628211ull;
+    }
+
+    return res;
+}
+
+} // namespace codecs
+
+} // namespace cashbook
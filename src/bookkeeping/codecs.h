@@ -0,0 +1,124 @@
+#ifndef CODECS_H
+#define CODECS_H
+
+#include "bookkeeping/bookkeeping.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+
+namespace cashbook
+{
+
+/**
+ * @brief Encoding of scalar fields of storage files.
+ * @details Parsers work on raw scalars of YAML parser and do not allocate.
+ *          Every parser falls back to Qt's one if scalar is not in a format
+ *          which cashbook writes itself, so hand edited files are read the
+ *          same way as before.
+ */
+namespace codecs
+{
+
+/**
+ * Parses `dd.MM.yyyy` date. Returns null date for malformed string.
+ */
+QDate parseDate(std::string_view str);
+
+/**
+ * Formats date as `dd.MM.yyyy`. Null date gives empty string.
+ */
+std::string formatDate(const QDate &date);
+
+/**
+ * Parses uuid with or without braces. Returns null uuid for malformed string.
+ */
+QUuid parseUuid(std::string_view str);
+
+/**
+ * Formats uuid as `QUuid::toString()` does, i.e. lowercase and with braces.
+ */
+std::string formatUuid(const QUuid &id);
+
+/**
+ * Parses amount of cents. Amounts are written as int64 integers, though
+ * floating point scalars are accepted as well and rounded to a cent.
+ */
+bool parseCents(std::string_view str, qint64 &cents);
+
+/**
+ * FNV-1a hash of bytes. Unlike `qHash` it does not depend on a platform or
+ * Qt version, so it may be stored in files.
+ */
+inline constexpr quint64 HashSeed {14695981039346656037ull};
+quint64 hash(std::string_view bytes, quint64 seed = HashSeed);
+
+/**
+ * @brief Config names of an enum, indexed by enum values.
+ */
+template <class Enum, size_t N>
+class EnumNames
+{
+public:
+    constexpr EnumNames(std::array<std::string_view, N> names, Enum fallback)
+        : m_names(names)
+        , m_fallback(fallback)
+    {}
+
+    Enum fromName(std::string_view name) const {
+        for(size_t i = 0; i<N; ++i) {
+            if(m_names[i] == name) {
+                return static_cast<Enum>(i);
+            }
+        }
+        return m_fallback;
+    }
+
+    std::string_view name(Enum value) const {
+        const size_t i = static_cast<size_t>(value);
+        return i < N ? m_names[i] : m_names[static_cast<size_t>(m_fallback)];
+    }
+
+private:
+    std::array<std::string_view, N> m_names;
+    Enum m_fallback;
+};
+
+inline constexpr EnumNames<Transaction::Type::t, Transaction::Type::Count> transactionTypes {
+    {"In", "Out", "Transfer"},
+    Transaction::Type::Out
+};
+
+inline constexpr EnumNames<Wallet::Type::t, Wallet::Type::Count> walletTypes {
+    {"Common", "Cash", "Card", "Account", "Deposit", "Investment", "CryptoCurrency", "Points"},
+    Wallet::Type::Common
+};
+
+inline constexpr EnumNames<Wallet::Availability::t, Wallet::Availability::Count> availabilities {
+    {"Free", "InAMonth", "InAQarter", "InAYear", "In3Years", "In5Years", "In10Years", "In20Years", "AfterRetirement", "ForFutureGenerations"},
+    Wallet::Availability::Free
+};
+
+inline constexpr EnumNames<Wallet::InvestmentInfo::Type::t, Wallet::InvestmentInfo::Type::Count> investmentTypes {
+    {"Common", "Currency", "Stocks", "Metals", "CryptoCurrency", "RealEstate"},
+    Wallet::InvestmentInfo::Type::Common
+};
+
+inline constexpr EnumNames<LogFormat, static_cast<size_t>(LogFormat::Count)> logFormats {
+    {"Yaml", "Segments"},
+    LogFormat::Segments
+};
+
+inline QString toQString(std::string_view str) {
+    return QString::fromLatin1(str.data(), static_cast<qsizetype>(str.size()));
+}
+
+inline std::string_view toStringView(const QByteArray &str) {
+    return std::string_view(str.constData(), static_cast<size_t>(str.size()));
+}
+
+} // namespace codecs
+
+} // namespace cashbook
+
+#endif // CODECS_H
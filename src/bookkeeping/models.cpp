@@ -1,5 +1,6 @@
 #include "models.h"
 #include "gui/widgets/widgets.h"
+#include "bookkeeping/trace.h"
 
 #include <QSet>
 #include <functional>
@@ -10,6 +11,7 @@
 #include <QApplication>
 #include <QPainter>
 #include <QDebug>
+#include <QtConcurrent/QtConcurrentMap>
 
 #include <unordered_map>
 #include <optional>
@@ -119,7 +121,9 @@ static bool insertRows(Model *model, std::function<DataType()> createData, int p
     model->beginInsertRows(parent, position, position + rows - 1);
     for(int i = 0; i<rows; ++i) {
         parentItem->addChildAt(createData(), static_cast<size_t>(position));
+        model->m_data.indexSubtree(parentItem->at(static_cast<size_t>(position)));
     }
+    model->m_data.renumber();
 
     model->endInsertRows();
 
@@ -174,8 +178,10 @@ static bool removeRows(Model *model, int position, int rows, const QModelIndex &
 
     model->beginRemoveRows(parent, position, position + rows - 1);
     for(int i = 0; i<rows; ++i) {
+        model->m_data.unindexSubtree(parentItem->at(static_cast<size_t>(position)));
         parentItem->removeChildAt(static_cast<size_t>(position));
     }
+    model->m_data.renumber();
     model->endRemoveRows();
 
     return success;
@@ -192,6 +198,8 @@ static bool moveRow(Model *model, const QModelIndex &sourceParent, int sourceRow
 
     model->beginMoveRows(sourceParent, sourceRow, sourceRow, destinationParent, destinationChild);
     srcChildItem->attachSelfAsChildAt(dstParentItem, static_cast<size_t>(destinationChild)-static_cast<size_t>(down));
+    model->m_data.renumber();
+    PathCache::invalidateAll();
     model->endMoveRows();
 
     return true;
@@ -327,7 +335,10 @@ bool CategoriesModel::setData(const QModelIndex &index, const QVariant &value, i
     Node<Category> *item = getItem(index);
     switch(index.column())
     {
-        case CategoriesColumn::Name: item->data.setName(value.toString()); break;
+        case CategoriesColumn::Name: {
+            item->data.setName(value.toString());
+            PathCache::invalidateAll();
+        } break;
     }
     emit dataChanged(index, index);
     m_data.setChanged();
@@ -351,20 +362,6 @@ int WalletsModel::columnCount(const QModelIndex &parent) const
     return WalletColumn::Count;
 }
 
-static Money calcTreeAmount(Node<Wallet> *item)
-{
-    if(item->isLeaf()) {
-        return item->data.amount;
-    } else {
-        Money res;
-        for(size_t i = 0; i<item->childCount(); ++i) {
-            res += calcTreeAmount(item->at(i));
-        }
-
-        return res;
-    }
-}
-
 QVariant WalletsModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid()) {
@@ -396,7 +393,7 @@ QVariant WalletsModel::data(const QModelIndex &index, int role) const
                     return static_cast<double>(money);
                 }
             } else {
-                return formatMoney(calcTreeAmount(item));
+                return formatMoney(m_data.treeAmount(item));
             }
     }
 
@@ -418,6 +415,30 @@ QModelIndex WalletsModel::itemIndex(const Node<Wallet> *item) const
     return common::tree::itemIndex<WalletsModel, Wallet>(this, item);
 }
 
+void WalletsModel::amountChanged(const Node<Wallet> *node)
+{
+    amountsChanged({node});
+}
+
+void WalletsModel::amountsChanged(const std::set<const Node<Wallet> *> &nodes)
+{
+    std::set<const Node<Wallet> *> changed;
+    for(const Node<Wallet> *node : nodes) {
+        for(const Node<Wallet> *item : m_data.invalidateTreeAmount(node)) {
+            changed.insert(item);
+        }
+    }
+
+    for(const Node<Wallet> *item : changed) {
+        if(item == m_data.rootItem) {
+            continue;
+        }
+
+        const QModelIndex amountIndex = itemIndex(item).siblingAtColumn(WalletColumn::Amount);
+        emit dataChanged(amountIndex, amountIndex);
+    }
+}
+
 QVariant WalletsModel::headerData(int section, Qt::Orientation orientation,
                                int role) const
 {
@@ -444,7 +465,9 @@ bool WalletsModel::insertRows(int position, int rows, const QModelIndex &parent)
         w.name = tr("Новый кошелек");
         return w;
     };
-    return m_data.changeFilter( common::tree::insertRows<WalletsModel, Wallet>(this, createCategory, position, rows, parent) );
+    const bool res = m_data.changeFilter( common::tree::insertRows<WalletsModel, Wallet>(this, createCategory, position, rows, parent) );
+    amountChanged(getItem(parent)); // parent may stop being a leaf
+    return res;
 }
 
 QModelIndex WalletsModel::parent(const QModelIndex &index) const
@@ -454,12 +477,20 @@ QModelIndex WalletsModel::parent(const QModelIndex &index) const
 
 bool WalletsModel::removeRows(int position, int rows, const QModelIndex &parent)
 {
-    return m_data.changeFilter( common::tree::removeRows(this, position, rows, parent) );
+    const bool res = m_data.changeFilter( common::tree::removeRows(this, position, rows, parent) );
+    amountChanged(getItem(parent));
+    return res;
 }
 
 bool WalletsModel::moveRow(const QModelIndex &sourceParent, int sourceRow, const QModelIndex &destinationParent, int destinationChild)
 {
-    return m_data.changeFilter( common::tree::moveRow(this, sourceParent, sourceRow, destinationParent, destinationChild) );
+    const Node<Wallet> *oldParent = getItem(sourceParent);
+    const Node<Wallet> *node = oldParent->at(static_cast<size_t>(sourceRow));
+
+    const bool res = m_data.changeFilter( common::tree::moveRow(this, sourceParent, sourceRow, destinationParent, destinationChild) );
+    amountChanged(oldParent);
+    amountChanged(node->parent);
+    return res;
 }
 
 int WalletsModel::rowCount(const QModelIndex &parent) const
@@ -477,11 +508,17 @@ bool WalletsModel::setData(const QModelIndex &index, const QVariant &value, int
 
     switch(index.column())
     {
-        case WalletColumn::Name: item->data.name = value.toString(); break;
+        case WalletColumn::Name: {
+            item->data.name = value.toString();
+            PathCache::invalidateAll();
+        } break;
         case WalletColumn::Amount: item->data.amount = value.toDouble(); break;
     }
 
     emit dataChanged(index, index);
+    if(index.column() == WalletColumn::Amount) {
+        amountChanged(item->parent);
+    }
     m_data.setChanged();
 
     return true;
@@ -555,6 +592,7 @@ bool OwnersModel::insertRows(int position, int rows, const QModelIndex &parent)
     Q_UNUSED(parent);
     beginInsertRows(parent, position, position + rows - 1);
     m_data.owners.insert(position, rows, tr("Новый пользователь"));
+    m_data.rebuildIndex();
     endInsertRows();
     m_data.setChanged();
     return true;
@@ -572,6 +610,7 @@ bool OwnersModel::removeRows(int position, int rows, const QModelIndex &parent)
 
     beginRemoveRows(parent, position, position + rows - 1);
     m_data.owners.remove(position, rows);
+    m_data.rebuildIndex();
     endRemoveRows();
     m_data.setChanged();
     return true;
@@ -586,6 +625,7 @@ bool OwnersModel::moveRow(const QModelIndex &sourceParent, int sourceRow, const
     bool down = sourceRow < destinationChild;
     int shift = static_cast<int>(down);
     m_data.owners.move(sourceRow, destinationChild - shift);
+    m_data.rebuildIndex();
 
     endMoveRows();
     m_data.setChanged();
@@ -600,7 +640,9 @@ bool OwnersModel::moveRow(const QModelIndex &sourceParent, int sourceRow, const
 LogModel::LogModel(LogData &data, QObject *parent)
     : TableModel(parent)
     , m_data(data)
-{}
+{
+    connect(&m_fetchWatcher, &QFutureWatcher<void>::finished, this, &LogModel::finishFetch);
+}
 
 LogModel::~LogModel()
 {}
@@ -611,7 +653,7 @@ static QVariant archNodeData(const ArchNode<T> &archNode, int role)
     if(role == Qt::DisplayRole) {
         return archNodeToShortString(archNode);
     } else if(role == Qt::EditRole) {
-        return archNode;
+        return archNode.toVariant();
     } else if(role == Qt::BackgroundRole) {
         bool incorrect = false;
         if(archNode.isValidPointer()) {
@@ -698,7 +740,7 @@ QVariant LogModel::data(const QModelIndex &index, int role) const
         }
 
     } else if(column == LogColumn::Note) {
-        return t.note;
+        return t.note.get();
     }
 
     return QVariant();
@@ -800,10 +842,17 @@ bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role
     }
 
     Transaction &t = m_data.log[static_cast<size_t>(index.row())];
+    const Transaction before = t;
+    bool typeChanged = false;
 
     switch(index.column())
     {
-        case LogColumn::Date: t.date = value.toDate(); break;
+        case LogColumn::Date: {
+            // transaction leaves its old month, so both files should be saved
+            m_data.markMonthChanged(Month(t.date));
+            t.date = value.toDate();
+            m_data.invalidateIndices();
+        } break;
         case LogColumn::Type: {
             auto oldType = t.type;
             t.type = value.value<Transaction::Type::t>();
@@ -811,16 +860,7 @@ bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role
                 t.category.setNull();
                 t.from.setNull();
                 t.to.setNull();
-                emit dataChanged(
-                  createIndex(index.row(), LogColumn::Category),
-                  createIndex(index.row(), LogColumn::Category),
-                  {Qt::DisplayRole, Qt::EditRole}
-                );
-                emit dataChanged(
-                  createIndex(index.row(), LogColumn::From),
-                  createIndex(index.row(), LogColumn::To),
-                  {Qt::DisplayRole, Qt::EditRole}
-                );
+                typeChanged = true;
             }
         } break;
         case LogColumn::Category: {
@@ -834,9 +874,25 @@ bool LogModel::setData(const QModelIndex &index, const QVariant &value, int role
         case LogColumn::Note: t.note = value.toString(); break;
     }
 
-    emit dataChanged(index, index);
-    m_data.changedMonths.insert(Month(t.date));
+    // row indices are patched first: proxies read them on `dataChanged`
+    m_data.markMonthChanged(Month(t.date));
+    m_data.updateRow(static_cast<size_t>(index.row()));
     m_data.setChanged();
+    m_data.aggregates.edited(before, t);
+
+    if(typeChanged) {
+        emit dataChanged(
+          createIndex(index.row(), LogColumn::Category),
+          createIndex(index.row(), LogColumn::Category),
+          {Qt::DisplayRole, Qt::EditRole}
+        );
+        emit dataChanged(
+          createIndex(index.row(), LogColumn::From),
+          createIndex(index.row(), LogColumn::To),
+          {Qt::DisplayRole, Qt::EditRole}
+        );
+    }
+    emit dataChanged(index, index);
 
     return true;
 }
@@ -858,12 +914,10 @@ bool LogModel::removeRows(int position, int rows, const QModelIndex &parent)
     Q_UNUSED(parent);
     beginRemoveRows(parent, position, position + rows - 1);
 
-    m_data.changedMonths.insert(Month(m_data.log[static_cast<size_t>(position)].date));
-    m_data.log.erase(std::next(m_data.log.begin(), position), std::next(m_data.log.begin(), position+rows));
+    m_data.removeRows(static_cast<size_t>(position), static_cast<size_t>(rows));
     m_data.unanchored -= 1;
 
     endRemoveRows();
-    m_data.setChanged();
     return true;
 }
 
@@ -875,8 +929,12 @@ bool LogModel::copyTop()
 
     insertRow(0);
 
+    const Transaction before = m_data.log[0];
     m_data.log[0] = m_data.log[1];
     m_data.log[0].note.clear();
+    m_data.aggregates.edited(before, m_data.log[0]);
+    m_data.invalidateIndices();
+    m_data.markMonthChanged(Month(m_data.log[0].date));
     emit dataChanged(index(0, LogColumn::Start), index(0, LogColumn::Count), {Qt::DisplayRole});
     m_data.setChanged();
     return true;
@@ -927,6 +985,128 @@ bool LogModel::normalizeData()
     return false;
 }
 
+bool LogModel::canFetchMore(const QModelIndex &parent) const
+{
+    if(parent.isValid()) {
+        return false;
+    }
+
+    return !m_data.storedMonths.empty() && m_fetching.empty();
+}
+
+void LogModel::fetchMore(const QModelIndex &parent)
+{
+    if(!canFetchMore(parent)) {
+        return;
+    }
+
+    // view asks for more rows while scrolling, so one month at a time is enough
+    std::vector<std::unique_ptr<StoredMonth>> months;
+    months.push_back(std::move(m_data.storedMonths.front()));
+    m_data.storedMonths.pop_front();
+
+    months.front()->read();
+    appendStoredMonths(months);
+}
+
+void LogModel::fetchOlder(const QDate &date)
+{
+    CASHBOOK_TRACE_SCOPE("fetchOlder");
+    // finishing a fetch may start the pending one
+    while(!m_fetching.empty()) {
+        m_fetchWatcher.waitForFinished();
+        finishFetch();
+    }
+
+    auto months = takeStoredMonths(date);
+    if(months.empty()) {
+        return;
+    }
+
+    QtConcurrent::blockingMap(months, [](std::unique_ptr<StoredMonth> &month) {
+        month->read();
+    });
+    appendStoredMonths(months);
+}
+
+void LogModel::fetchOlderAsync(const QDate &date)
+{
+    if(!m_fetching.empty()) {
+        // fetch the rest when the current one is over. Null date stands for all months
+        if(!m_pendingFetch || (!m_pendingFetch->isNull() && (date.isNull() || date < *m_pendingFetch))) {
+            m_pendingFetch = date;
+        }
+        return;
+    }
+
+    m_fetching = takeStoredMonths(date);
+    if(m_fetching.empty()) {
+        return;
+    }
+
+    m_fetchWatcher.setFuture(QtConcurrent::map(m_fetching, [](std::unique_ptr<StoredMonth> &month) {
+        month->read();
+    }));
+}
+
+std::vector<std::unique_ptr<StoredMonth>> LogModel::takeStoredMonths(const QDate &date)
+{
+    std::vector<std::unique_ptr<StoredMonth>> res;
+
+    auto &stored = m_data.storedMonths;
+    while(!stored.empty() && (date.isNull() || !(stored.front()->month < Month(date)))) {
+        res.push_back(std::move(stored.front()));
+        stored.pop_front();
+    }
+
+    return res;
+}
+
+void LogModel::appendStoredMonths(std::vector<std::unique_ptr<StoredMonth>> &months)
+{
+    CASHBOOK_TRACE_SCOPE("appendStoredMonths");
+    std::vector<MonthLog> monthLogs;
+    monthLogs.reserve(months.size());
+
+    size_t rows = 0;
+    for(auto &month : months) {
+        monthLogs.push_back(month->take());
+        rows += monthLogs.back().transactions.size();
+    }
+    months.clear();
+
+    if(rows) {
+        const int first = rowCount();
+        beginInsertRows(QModelIndex(), first, first + static_cast<int>(rows) - 1);
+    }
+
+    // stored months are older than loaded ones, so log stays sorted
+    for(MonthLog &monthLog : monthLogs) {
+        m_data.appendMonthLog(std::move(monthLog));
+    }
+
+    if(rows) {
+        endInsertRows();
+    }
+
+    emit historyFetched();
+}
+
+void LogModel::finishFetch()
+{
+    if(m_fetching.empty()) {
+        return;
+    }
+
+    appendStoredMonths(m_fetching);
+
+    if(m_pendingFetch) {
+        const QDate date = *m_pendingFetch;
+        m_pendingFetch.reset();
+        fetchOlderAsync(date);
+    }
+}
+
 FilteredLogModel::FilteredLogModel(const QDate &from, const QDate &to, Transaction::Type::t type, const Node<Category> *category, QObject *parent)
     : QSortFilterProxyModel(parent)
     , m_from(from)
@@ -941,30 +1121,17 @@ bool FilteredLogModel::filterAcceptsRow(int sourceRow, const QModelIndex &source
 
     LogModel *model = qobject_cast<LogModel*>(sourceModel());
 
-    const Transaction &t = model->m_data.log[static_cast<size_t>(sourceRow)];
-    if(t.type != m_type) {
+    const LogColumns &log = model->m_data.columns();
+    const size_t row = static_cast<size_t>(sourceRow);
+    if(log.types[row] != m_type) {
         return false;
     }
 
-    if(t.date < m_from || t.date > m_to) {
+    if(log.days[row] < m_from.toJulianDay() || log.days[row] > m_to.toJulianDay()) {
         return false;
     }
 
-    if(!t.category.isValidPointer()) {
-        return false;
-    }
-
-    const Node<Category> *node = t.category.toPointer();
-
-    while(node) {
-        if(node == m_category) {
-            return true;
-        }
-
-        node = node->parent;
-    }
-
-    return false;
+    return isNodeBelongsTo(log.categories[row], m_category);
 }
 
 //
@@ -1357,6 +1524,7 @@ bool TasksModel::setData(const QModelIndex &index, const QVariant &value, int ro
     || origin.from != task.from
     || origin.to != task.to
     || origin.amount != task.amount) {
+        emit historyNeeded(task.from);
         m_log.updateTask(task);
         emit dataChanged(
           createIndex(index.row(), TasksColumn::Spent),
@@ -1788,12 +1956,12 @@ void ModelsDelegate::setModelData(QWidget* editor, QAbstractItemModel* model, co
 
     // Categories tree
     if(cat) {
-       model->setData(index, ArchNode<Category>(cat->node()), Qt::EditRole);
+       model->setData(index, ArchNode<Category>(cat->node()).toVariant(), Qt::EditRole);
        return;
 
     // Wallets tree
     } else if(wal) {
-        model->setData(index, ArchNode<Wallet>(wal->node()), Qt::EditRole);
+        model->setData(index, ArchNode<Wallet>(wal->node()).toVariant(), Qt::EditRole);
         return;
     }
 
@@ -1832,16 +2000,49 @@ DataModels::DataModels(Data& data)
     , briefStatisticsModel(data.statistics.brief)
     , m_data(data)
 {
+    // removed nodes are archived in the whole log, so months which are still
+    // on disk should be loaded before. Slots are called in connection order
+    const auto fetchHistory = [this]() {
+        logModel.fetchOlder(QDate());
+    };
+    QObject::connect(&inCategoriesModel, &CategoriesModel::nodesGonnaBeRemoved, &logModel, fetchHistory);
+    QObject::connect(&outCategoriesModel, &CategoriesModel::nodesGonnaBeRemoved, &logModel, fetchHistory);
+    QObject::connect(&walletsModel, &WalletsModel::nodesGonnaBeRemoved, &logModel, fetchHistory);
+    for(TasksModel &model : tasksModels) {
+        QObject::connect(&model, &TasksModel::historyNeeded, &logModel, &LogModel::fetchOlder);
+    }
+
     QObject::connect(&ownersModel, &OwnersModel::nodesGonnaBeRemoved, &data, &Data::onOwnersRemove);
     QObject::connect(&inCategoriesModel, &CategoriesModel::nodesGonnaBeRemoved, &data, &Data::onInCategoriesRemove);
     QObject::connect(&outCategoriesModel, &CategoriesModel::nodesGonnaBeRemoved, &data, &Data::onOutCategoriesRemove);
     QObject::connect(&walletsModel, &WalletsModel::nodesGonnaBeRemoved, &data, &Data::onWalletsRemove);
+
+    // moving a category to another parent changes sums of its old and new ancestors
+    for(CategoriesModel *model : {&inCategoriesModel, &outCategoriesModel}) {
+        QObject::connect(model, &QAbstractItemModel::rowsMoved, model, [this, model](const QModelIndex &sourceParent, int start, int end, const QModelIndex &destinationParent, int row) {
+            Q_UNUSED(start);
+            Q_UNUSED(end);
+            if(sourceParent != destinationParent) {
+                m_data.log.aggregates.categoryMoved(model->getItem(destinationParent)->at(static_cast<size_t>(row)));
+            }
+        });
+    }
 }
 
 bool DataModels::anchoreTransactions()
 {
+    std::set<const Node<Wallet> *> wallets;
+    for(int i = 0; i<logModel.m_data.unanchored; ++i) {
+        const Transaction &t = logModel.m_data.log[static_cast<size_t>(i)];
+        for(const ArchNode<Wallet> *wallet : {&t.from, &t.to}) {
+            if(wallet->toPointer()) {
+                wallets.insert(wallet->toPointer());
+            }
+        }
+    }
+
     if(logModel.anchoreTransactions()) {
-        walletsModel.update();
+        walletsModel.amountsChanged(wallets);
         emit m_data.categoriesStatisticsUpdated();
         return true;
     }
@@ -7,6 +7,8 @@
 #include <QSortFilterProxyModel>
 #include <QStyledItemDelegate>
 #include <QItemDelegate>
+#include <QFutureWatcher>
+#include <optional>
 
 class QTreeView;
 
@@ -150,9 +152,21 @@ public:
     Node<Wallet> *getItem(const QModelIndex &index) const;
     QModelIndex itemIndex(const Node<Wallet> *item) const;
 
+    /**
+     * Updates sums of `node` ancestors after its amount or its subtree changed.
+     */
+    void amountChanged(const Node<Wallet> *node);
+
+    /**
+     * Same as above for several nodes. Shared ancestors are repainted once.
+     */
+    void amountsChanged(const std::set<const Node<Wallet> *> &nodes);
+
     Node<Wallet> *addChild(const Wallet &data) {
         auto node = new Node<Wallet>(data, m_data.rootItem);
         m_data.rootItem->children.push_back(node);
+        m_data.indexSubtree(node);
+        m_data.renumber();
         return node;
     }
 
@@ -255,6 +269,29 @@ public:
     void updateNote(size_t row, const QString &note);
     void updateTask(Task &task) const;
     bool normalizeData();
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    /**
+     * Loads every stored month starting from `date`'s one, or all of them
+     * if `date` is null. `fetchOlder()` blocks, `fetchOlderAsync()` reads
+     * files on the thread pool and emits `historyFetched()` when rows are in.
+     */
+    void fetchOlder(const QDate &date);
+    void fetchOlderAsync(const QDate &date);
+
+signals:
+    void historyFetched();
+
+private:
+    std::vector<std::unique_ptr<StoredMonth>> takeStoredMonths(const QDate &date);
+    void appendStoredMonths(std::vector<std::unique_ptr<StoredMonth>> &months);
+    void finishFetch();
+
+    std::vector<std::unique_ptr<StoredMonth>> m_fetching;
+    QFutureWatcher<void> m_fetchWatcher;
+    std::optional<QDate> m_pendingFetch;
 };
 
 class FilteredLogModel : public QSortFilterProxyModel
@@ -352,6 +389,9 @@ public:
     bool removeRows(int position, int rows, const QModelIndex &parent = QModelIndex()) override;
     bool moveRow(const QModelIndex &sourceParent, int sourceRow, const QModelIndex &destinationParent, int destinationChild);
 
+signals:
+    void historyNeeded(const QDate &from); // months from `from` should be loaded before a task is summed
+
 private:
     const LogData &m_log;
 };
@@ -0,0 +1,338 @@
+#include "segment.h"
+
+#include <QFile>
+#include <cstring>
+#include <limits>
+
+namespace cashbook
+{
+
+static constexpr qint32 NullDay {std::numeric_limits<qint32>::min()};
+static constexpr size_t UuidSize {16};
+
+static size_t align(size_t offset)
+{
+    return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+/**
+ * @brief Offsets of segment's columns and tables calculated from the header.
+ */
+struct SegmentLayout
+{
+    explicit SegmentLayout(const segment::Header &header)
+    {
+        const size_t rows = header.rows;
+        size_t offset = align(sizeof(segment::Header));
+
+        const auto column = [&offset](size_t bytes) {
+            const size_t res = offset;
+            offset = align(offset + bytes);
+            return res;
+        };
+
+        amounts = column(rows * sizeof(qint64));
+        days = column(rows * sizeof(qint32));
+        categories = column(rows * sizeof(qint32));
+        from = column(rows * sizeof(qint32));
+        to = column(rows * sizeof(qint32));
+        notes = column(rows * sizeof(qint32));
+        types = column(rows * sizeof(quint8));
+        uuids = column(header.uuids * UuidSize);
+        stringOffsets = column((static_cast<size_t>(header.strings) + 1) * sizeof(quint32));
+        strings = column(header.stringBytes);
+        size = offset;
+    }
+
+    size_t amounts {0};
+    size_t days {0};
+    size_t categories {0};
+    size_t from {0};
+    size_t to {0};
+    size_t notes {0};
+    size_t types {0};
+    size_t uuids {0};
+    size_t stringOffsets {0};
+    size_t strings {0};
+    size_t size {0};
+};
+
+//
+// Save
+//
+
+void SegmentWriter::append(const Transaction &t)
+{
+    // fields which are not stored in `.pitm` files are not stored in segments either
+    m_amounts.push_back(t.amount.as_cents());
+    m_days.push_back(t.date.isValid() ? static_cast<qint32>(t.date.toJulianDay()) : NullDay);
+    m_categories.push_back(t.type != Transaction::Type::Transfer ? reference(t.category) : segment::NullRef);
+    m_from.push_back(t.type != Transaction::Type::In ? reference(t.from) : segment::NullRef);
+    m_to.push_back(t.type != Transaction::Type::Out ? reference(t.to) : segment::NullRef);
+    m_notes.push_back(t.note.isEmpty() ? segment::NoString : stringIndex(t.note.get()));
+    m_types.push_back(static_cast<quint8>(t.type));
+}
+
+qint32 SegmentWriter::uuidIndex(const QUuid &id)
+{
+    auto it = m_uuidIndices.constFind(id);
+    if(it != m_uuidIndices.constEnd()) {
+        return it.value();
+    }
+
+    const qint32 index = static_cast<qint32>(m_uuids.size());
+    m_uuids.push_back(id);
+    m_uuidIndices.insert(id, index);
+    return index;
+}
+
+qint32 SegmentWriter::stringIndex(const QString &str)
+{
+    auto it = m_stringIndices.constFind(str);
+    if(it != m_stringIndices.constEnd()) {
+        return it.value();
+    }
+
+    const qint32 index = static_cast<qint32>(m_stringOffsets.size() - 1);
+    m_strings += str.toUtf8();
+    m_stringOffsets.push_back(static_cast<quint32>(m_strings.size()));
+    m_stringIndices.insert(str, index);
+    return index;
+}
+
+template <class T>
+qint32 SegmentWriter::reference(const ArchNode<T> &node)
+{
+    if(node.isValidPointer()) {
+        const Node<T> *pointer = node.toPointer();
+        return pointer ? uuidIndex(pointer->data.id) : segment::NullRef;
+    }
+
+    return -(stringIndex(node.toString()) + 2);
+}
+
+QByteArray SegmentWriter::toByteArray() const
+{
+    segment::Header header;
+    std::memcpy(header.magic, segment::Magic, sizeof(header.magic));
+    header.version = segment::Version;
+    header.rows = static_cast<quint32>(m_amounts.size());
+    header.uuids = static_cast<quint32>(m_uuids.size());
+    header.strings = static_cast<quint32>(m_stringOffsets.size() - 1);
+    header.stringBytes = static_cast<quint32>(m_strings.size());
+
+    const SegmentLayout layout(header);
+
+    QByteArray res(static_cast<qsizetype>(layout.size), '\0');
+    char *p = res.data();
+
+    const auto write = [p](size_t offset, const auto &column) {
+        if(!column.empty()) {
+            std::memcpy(p + offset, column.data(), column.size() * sizeof(column[0]));
+        }
+    };
+
+    std::memcpy(p, &header, sizeof(header));
+    write(layout.amounts, m_amounts);
+    write(layout.days, m_days);
+    write(layout.categories, m_categories);
+    write(layout.from, m_from);
+    write(layout.to, m_to);
+    write(layout.notes, m_notes);
+    write(layout.types, m_types);
+
+    for(size_t i = 0; i<m_uuids.size(); ++i) {
+        const QByteArray uuid = m_uuids[i].toRfc4122();
+        std::memcpy(p + layout.uuids + i*UuidSize, uuid.constData(), UuidSize);
+    }
+
+    write(layout.stringOffsets, m_stringOffsets);
+    std::memcpy(p + layout.strings, m_strings.constData(), static_cast<size_t>(m_strings.size()));
+
+    return res;
+}
+
+bool SegmentWriter::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    const QByteArray bytes = toByteArray();
+    return file.write(bytes) == bytes.size();
+}
+
+//
+// Load
+//
+
+template <class T>
+static bool decodeReference(ArchNode<T> &node, qint32 ref, const std::vector<const Node<T> *> &nodes, const std::vector<QString> &strings)
+{
+    if(ref == segment::NullRef) {
+        node = static_cast<const Node<T>*>(nullptr);
+        return true;
+    }
+
+    if(ref >= 0) {
+        if(static_cast<size_t>(ref) >= nodes.size()) {
+            return false;
+        }
+        node = nodes[static_cast<size_t>(ref)];
+        return true;
+    }
+
+    const size_t str = static_cast<size_t>(-(static_cast<qint64>(ref) + 2));
+    if(str >= strings.size()) {
+        return false;
+    }
+
+    node = ArchiveString(strings[str]);
+    return true;
+}
+
+static bool readSegment(MonthLog &monthLog, const uchar *p, size_t size, const Data &data)
+{
+    if(size < sizeof(segment::Header)) {
+        return false;
+    }
+
+    segment::Header header;
+    std::memcpy(&header, p, sizeof(header));
+
+    if(std::memcmp(header.magic, segment::Magic, sizeof(header.magic)) != 0 || header.version != segment::Version) {
+        return false;
+    }
+
+    const SegmentLayout layout(header);
+    if(layout.size > size) {
+        return false;
+    }
+
+    // string table
+    const quint32 *stringOffsets = reinterpret_cast<const quint32 *>(p + layout.stringOffsets);
+    const char *stringsBlob = reinterpret_cast<const char *>(p + layout.strings);
+
+    std::vector<QString> strings;
+    strings.reserve(header.strings);
+    for(quint32 i = 0; i<header.strings; ++i) {
+        const quint32 begin = stringOffsets[i];
+        const quint32 end = stringOffsets[i+1];
+        if(begin > end || end > header.stringBytes) {
+            return false;
+        }
+        strings.push_back(QString::fromUtf8(stringsBlob + begin, static_cast<qsizetype>(end - begin)));
+    }
+
+    // uuid table. Same uuid may be a wallet or a category, depending on a column
+    std::vector<const Node<Wallet> *> wallets(header.uuids);
+    std::vector<const Node<Category> *> inCategories(header.uuids);
+    std::vector<const Node<Category> *> outCategories(header.uuids);
+
+    for(size_t i = 0; i<header.uuids; ++i) {
+        const char *uuid = reinterpret_cast<const char *>(p + layout.uuids + i*UuidSize);
+        const QUuid id = QUuid::fromRfc4122(QByteArrayView(uuid, UuidSize));
+
+        wallets[i] = data.wallets.ids.find(id);
+        inCategories[i] = data.inCategories.ids.find(id);
+        outCategories[i] = data.outCategories.ids.find(id);
+    }
+
+    // columns
+    const qint64 *amounts = reinterpret_cast<const qint64 *>(p + layout.amounts);
+    const qint32 *days = reinterpret_cast<const qint32 *>(p + layout.days);
+    const qint32 *categories = reinterpret_cast<const qint32 *>(p + layout.categories);
+    const qint32 *from = reinterpret_cast<const qint32 *>(p + layout.from);
+    const qint32 *to = reinterpret_cast<const qint32 *>(p + layout.to);
+    const qint32 *notes = reinterpret_cast<const qint32 *>(p + layout.notes);
+    const quint8 *types = reinterpret_cast<const quint8 *>(p + layout.types);
+
+    monthLog.transactions.reserve(header.rows);
+
+    // notes are interned once per month, rows share them
+    std::vector<PooledString> pooledNotes(strings.size());
+
+    for(size_t i = 0; i<header.rows; ++i) {
+        Transaction t;
+
+        if(types[i] >= Transaction::Type::Count) {
+            return false;
+        }
+
+        t.date = days[i] == NullDay ? QDate() : QDate::fromJulianDay(days[i]);
+        t.type = static_cast<Transaction::Type::t>(types[i]);
+        t.amount = Money(static_cast<intmax_t>(amounts[i]));
+
+        if(notes[i] != segment::NoString) {
+            if(notes[i] < 0 || static_cast<size_t>(notes[i]) >= strings.size()) {
+                return false;
+            }
+            PooledString &note = pooledNotes[static_cast<size_t>(notes[i])];
+            if(note.isEmpty()) {
+                note = strings[static_cast<size_t>(notes[i])];
+            }
+            t.note = note;
+        }
+
+        if(t.type != Transaction::Type::Transfer) {
+            const auto &categoryNodes = t.type == Transaction::Type::In ? inCategories : outCategories;
+            if(!decodeReference(t.category, categories[i], categoryNodes, strings)) {
+                return false;
+            }
+        }
+
+        if(t.type != Transaction::Type::In) {
+            if(!decodeReference(t.from, from[i], wallets, strings)) {
+                return false;
+            }
+        }
+
+        if(t.type != Transaction::Type::Out) {
+            if(!decodeReference(t.to, to[i], wallets, strings)) {
+                return false;
+            }
+        }
+
+        monthLog.append(std::move(t));
+    }
+
+    return true;
+}
+
+bool loadSegment(MonthLog &monthLog, const QString &fileName, const Data &data)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    uchar *p = file.map(0, size);
+    if(!p) {
+        return false;
+    }
+
+    const bool ok = readSegment(monthLog, p, static_cast<size_t>(size), data);
+    file.unmap(p);
+
+    if(!ok) {
+        monthLog = MonthLog();
+    }
+
+    return ok;
+}
+
+bool loadSegment(MonthLog &monthLog, const QByteArray &bytes, const Data &data)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(bytes.constData());
+    const bool ok = readSegment(monthLog, p, static_cast<size_t>(bytes.size()), data);
+
+    if(!ok) {
+        monthLog = MonthLog();
+    }
+
+    return ok;
+}
+
+} // namespace cashbook
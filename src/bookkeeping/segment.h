@@ -0,0 +1,96 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include "bookkeeping/bookkeeping.h"
+
+#include <QHash>
+#include <QByteArray>
+
+namespace cashbook
+{
+
+/**
+ * @brief Binary columnar storage of a single month of the log.
+ * @details Month segment is a compact alternative to `.pitm` month files.
+ *          Segment is memory mapped on load and its fixed width columns are
+ *          read directly, without building any YAML DOM.
+ *
+ * Layout (little endian, every column starts at 8-byte aligned offset):
+ * - `segment::Header`;
+ * - `qint64` amounts in cents;
+ * - `qint32` dates as julian day numbers;
+ * - `qint32` category, from and to references;
+ * - `qint32` notes as string table indices, `-1` for an empty note;
+ * - `quint8` transaction types;
+ * - uuid table, 16 bytes per RFC 4122 uuid;
+ * - string table: `quint32` offsets (one extra for the end) and UTF-8 blob.
+ *
+ * Reference is either an index in the uuid table, `NullRef` for a null
+ * pointer or `-(index + 2)` for an archived path in the string table.
+ */
+namespace segment
+{
+
+struct Header
+{
+    char magic[4];
+    quint32 version;
+    quint32 rows;
+    quint32 uuids;
+    quint32 strings;
+    quint32 stringBytes;
+};
+
+static constexpr char Magic[4] {'P', 'S', 'E', 'G'};
+static constexpr quint32 Version {1};
+static constexpr qint32 NullRef {-1};
+static constexpr qint32 NoString {-1};
+
+} // namespace segment
+
+class SegmentWriter
+{
+public:
+    void append(const Transaction &t);
+    QByteArray toByteArray() const;
+    bool save(const QString &fileName) const;
+
+private:
+    qint32 uuidIndex(const QUuid &id);
+    qint32 stringIndex(const QString &str);
+
+    template <class T>
+    qint32 reference(const ArchNode<T> &node);
+
+    std::vector<qint64> m_amounts;
+    std::vector<qint32> m_days;
+    std::vector<qint32> m_categories;
+    std::vector<qint32> m_from;
+    std::vector<qint32> m_to;
+    std::vector<qint32> m_notes;
+    std::vector<quint8> m_types;
+
+    std::vector<QUuid> m_uuids;
+    QHash<QUuid, qint32> m_uuidIndices;
+
+    QByteArray m_strings;
+    std::vector<quint32> m_stringOffsets {0};
+    QHash<QString, qint32> m_stringIndices;
+};
+
+/**
+ * Loads month segment `fileName` into `monthLog`. References are resolved
+ * through id indices of `data`.
+ *
+ * Returns `false` if file could not be mapped or is not a valid segment.
+ */
+bool loadSegment(MonthLog &monthLog, const QString &fileName, const Data &data);
+
+/**
+ * Same as above, but for a segment which is already read into memory.
+ */
+bool loadSegment(MonthLog &monthLog, const QByteArray &bytes, const Data &data);
+
+} // namespace cashbook
+
+#endif // SEGMENT_H
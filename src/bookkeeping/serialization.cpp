@@ -1,16 +1,22 @@
 #include "serialization.h"
 #include "bookkeeping/bookkeeping.h"
+#include "bookkeeping/segment.h"
+#include "bookkeeping/codecs.h"
+#include "bookkeeping/cache.h"
+#include "bookkeeping/trace.h"
 
 #include <askelib_qt/std/fs.h>
 #include <QFileInfo>
 #include <QDir>
 #include <QDirIterator>
+#include <QtConcurrent/QtConcurrentMap>
 #include <utility>
 #include <stack>
 #include <fstream>
 
 #include "qtyaml.h"
 #include <yaml-cpp/yaml.h>
+#include <yaml-cpp/eventhandler.h>
 
 namespace cashbook {
 
@@ -20,99 +26,207 @@ namespace storage
 static const int backupCount        {3};
 static const QString dateFormat     {"yyyy.MM"};
 static const QString ext            {".pitm"};
+static const QString segmentExt     {".pseg"};
 static const QString backupExt      {".backup"};
 static const QString rootDir        {"data"};
 static const QString backupDir      {"backup"};
 static const QString headName       {"_head"};
 static const QString headFile       { QString("%1/%2%3").arg(rootDir, headName, ext) };
+static const QString cacheFile      { QString("%1/_cache.pcache").arg(rootDir) };
 
 static QString monthFile(const QDate &month) {
     return QString("%1/%2%3").arg(rootDir, month.toString(dateFormat), ext);
 }
 
+static QString segmentFile(const QDate &month) {
+    return QString("%1/%2%3").arg(rootDir, month.toString(dateFormat), segmentExt);
+}
+
 } // namespace storage
 
+//
+// Month files
+//
+
+struct MonthFile
+{
+    Month month;
+    QString yamlPath;
+    QString segmentPath;
+    QDateTime yamlModified;
+    cache::FileStamp yamlStamp;
+    cache::FileStamp segmentStamp;
+    MonthLog log;
+};
+
+/**
+ * Lists month files newest first. Month may be stored both as `.pitm` file
+ * and as a segment. Segment is preferred unless `.pitm` file was modified
+ * after it, i.e. edited by hand.
+ */
+static std::vector<MonthFile> listMonthFiles()
+{
+    QDir dir(storage::rootDir, {QStringLiteral("*")+storage::ext, QStringLiteral("*")+storage::segmentExt});
+    dir.setFilter(QDir::Files);
+
+    std::map<QString, MonthFile, std::greater<QString>> files;
+    std::map<QString, QDateTime> segmentTimes;
+
+    for(const QFileInfo &file : dir.entryInfoList()) {
+        if(file.filePath() == storage::headFile) {
+            continue;
+        }
+
+        const QString month {file.completeBaseName()};
+        MonthFile &monthFile = files[month];
+        monthFile.month = Month(QDate::fromString(month, storage::dateFormat));
+
+        if(file.fileName().endsWith(storage::segmentExt)) {
+            monthFile.segmentPath = file.filePath();
+            monthFile.segmentStamp = cache::stamp(file);
+            segmentTimes[month] = file.lastModified();
+        } else {
+            monthFile.yamlPath = file.filePath();
+            monthFile.yamlModified = file.lastModified();
+            monthFile.yamlStamp = cache::stamp(file);
+        }
+    }
+
+    std::vector<MonthFile> res;
+    res.reserve(files.size());
+
+    for(auto &[month, monthFile] : files) {
+        const bool stale = !monthFile.segmentPath.isEmpty()
+                        && !monthFile.yamlPath.isEmpty()
+                        && segmentTimes[month] < monthFile.yamlModified;
+        if(stale) {
+            monthFile.segmentPath.clear();
+        }
+        res.push_back(std::move(monthFile));
+    }
+
+    return res;
+}
+
 //
 // Save
 //
 
-static void save(const IdableString &data, YAML::Node& node)
+} // namespace cashbook
+
+namespace YAML {
+
+static Emitter &operator<<(Emitter &out, const QString &str)
 {
-    node["id"] = data.id.toString();
-    node["str"] = static_cast<QString>(data);
+    return out << str.toStdString();
 }
 
-static void save(const OwnersData &data, YAML::Node& node)
+static Emitter &operator<<(Emitter &out, std::string_view str)
 {
-    for(const auto &owner : data.owners) {
-        YAML::Node obj;
-        save(owner, obj);
-        node.push_back(obj);
-    }
+    return out << std::string(str);
+}
+
+} // namespace YAML
+
+namespace cashbook {
+
+// Records are written straight into emitter. Emitted events are the same
+// `YAML::Node` would produce, so files are byte to byte the same as before:
+// empty sequences are written as null, scalars are not tagged.
+
+static void save(const IdableString &data, YAML::Emitter &out)
+{
+    out << YAML::BeginMap;
+    out << YAML::Key << "id" << YAML::Value << codecs::formatUuid(data.id);
+    out << YAML::Key << "str" << YAML::Value << static_cast<QString>(data);
+    out << YAML::EndMap;
 }
 
-static void save(const BanksData &data, YAML::Node& node)
+template <class Container>
+static void saveSequence(const Container &items, YAML::Emitter &out)
 {
-    for(const auto &bank : data.banks) {
-        YAML::Node obj;
-        save(bank, obj);
-        node.push_back(obj);
+    if(items.empty()) {
+        out << YAML::Null;
+        return;
+    }
+
+    out << YAML::BeginSeq;
+    for(const auto &item : items) {
+        save(item, out);
     }
+    out << YAML::EndSeq;
 }
 
-static void save(const Node<Category> *node, YAML::Node& nodeNodes)
+static void save(const OwnersData &data, YAML::Emitter &out)
 {
-    YAML::Node nodeNode;
+    saveSequence(data.owners, out);
+}
 
-    YAML::Node category;
-    save(node->data, category);
-    nodeNode["category"] = category;
-    nodeNode["regular"] = node->data.regular;
+static void save(const BanksData &data, YAML::Emitter &out)
+{
+    saveSequence(data.banks, out);
+}
+
+static void saveNodes(const Node<Category> *node, YAML::Emitter &out)
+{
+    out << YAML::BeginMap;
+
+    out << YAML::Key << "category" << YAML::Value;
+    save(node->data, out);
+    out << YAML::Key << "regular" << YAML::Value << node->data.regular;
 
     int children = static_cast<int>(node->childCount());
     if(children) {
-        nodeNode["children"] = children;
+        out << YAML::Key << "children" << YAML::Value << children;
     }
-    nodeNodes.push_back(nodeNode);
+
+    out << YAML::EndMap;
 
     for(const auto &child : node->children) {
-        save(child, nodeNodes);
+        saveNodes(child, out);
     }
 }
 
-static void save(const CategoriesData &data, YAML::Node& node)
+static void save(const CategoriesData &data, YAML::Emitter &out)
 {
-    save(data.rootItem, node);
+    out << YAML::BeginSeq;
+    saveNodes(data.rootItem, out);
+    out << YAML::EndSeq;
 }
 
 template <class T>
-static void save(const ArchPointer<T> &data, YAML::Node& node)
+static void save(const ArchPointer<T> &data, YAML::Emitter &out)
 {
+    out << YAML::BeginMap;
+
     bool valid = data.isValidPointer();
     if(valid) {
-        const Owner *pointer = data.toPointer();
+        const T *pointer = data.toPointer();
         if(pointer) {
-            node["ref"] = pointer->id.toString();
+            out << YAML::Key << "ref" << YAML::Value << codecs::formatUuid(pointer->id);
         } else {
-            node["ref"] = QUuid().toString();
+            out << YAML::Key << "ref" << YAML::Value << codecs::formatUuid(QUuid());
         }
     } else {
-        node["archive"] = data.toString();
+        out << YAML::Key << "archive" << YAML::Value << data.toString();
     }
+
+    out << YAML::EndMap;
 }
 
-static void save(const Wallet &wallet, YAML::Node& node)
+static void save(const Wallet &wallet, YAML::Emitter &out)
 {
-    node["id"] = wallet.id.toString();
-    node["type"] = Wallet::Type::toConfigString(wallet.type);
-    node["name"] = wallet.name;
-    node["amount"] = wallet.amount.as_cents();
+    out << YAML::BeginMap;
 
-    YAML::Node ownerJson;
-    save(wallet.info->owner, ownerJson);
-    node["owner"] = ownerJson;
-    node["canBeNegative"] = wallet.info->canBeNegative;
-    node["availability"] = Wallet::Availability::toConfigString(wallet.info->availability);
+    out << YAML::Key << "id" << YAML::Value << codecs::formatUuid(wallet.id);
+    out << YAML::Key << "type" << YAML::Value << codecs::walletTypes.name(wallet.type);
+    out << YAML::Key << "name" << YAML::Value << wallet.name;
+    out << YAML::Key << "amount" << YAML::Value << static_cast<long long>(wallet.amount.as_cents());
+
+    out << YAML::Key << "owner" << YAML::Value;
+    save(wallet.info->owner, out);
+    out << YAML::Key << "canBeNegative" << YAML::Value << wallet.info->canBeNegative;
+    out << YAML::Key << "availability" << YAML::Value << codecs::availabilities.name(wallet.info->availability);
 
     switch(wallet.type)
     {
@@ -125,7 +239,8 @@ static void save(const Wallet &wallet, YAML::Node& node)
         case Wallet::Type::Deposit:
         {
             const auto* info = static_cast<const Wallet::DepositInfo*>(wallet.info.get());
-            node["incomePercent"] = info->incomePercent;
+            // the same precision as `YAML::Node` gives to floats
+            out << YAML::Key << "incomePercent" << YAML::Value << YAML::Node(info->incomePercent).Scalar();
         }
         [[fallthrough]];
         case Wallet::Type::Account:
@@ -133,160 +248,172 @@ static void save(const Wallet &wallet, YAML::Node& node)
         {
             const auto* info = static_cast<const Wallet::AccountInfo*>(wallet.info.get());
 
-            YAML::Node bankJson;
-            save(info->bank, bankJson);
-            node["bank"] = bankJson;
+            out << YAML::Key << "bank" << YAML::Value;
+            save(info->bank, out);
         }
         break;
         case Wallet::Type::Investment:
         {
             const auto* info = static_cast<const Wallet::InvestmentInfo*>(wallet.info.get());
 
-            node["investmentType"] = Wallet::InvestmentInfo::Type::toConfigString(info->type);
+            out << YAML::Key << "investmentType" << YAML::Value << codecs::investmentTypes.name(info->type);
 
             if(info->account) {
-                YAML::Node bankJson;
-                save(info->account->bank, bankJson);
-                node["bank"] = bankJson;
+                out << YAML::Key << "bank" << YAML::Value;
+                save(info->account->bank, out);
             }
         }
         break;
     }
+
+    out << YAML::EndMap;
 }
 
-static void save(const Node<Wallet> *node, YAML::Node& nodeNodes)
+static void saveNodes(const Node<Wallet> *node, YAML::Emitter &out)
 {
-    YAML::Node nodeNode;
+    out << YAML::BeginMap;
 
-    YAML::Node wallet;
-    save(node->data, wallet);
-    nodeNode["wallet"] = wallet;
+    out << YAML::Key << "wallet" << YAML::Value;
+    save(node->data, out);
 
     int children = static_cast<int>(node->childCount());
     if(children) {
-        nodeNode["children"] = children;
+        out << YAML::Key << "children" << YAML::Value << children;
     }
 
-    nodeNodes.push_back(nodeNode);
+    out << YAML::EndMap;
 
     for(const Node<Wallet> *child : node->children) {
-        save(child, nodeNodes);
+        saveNodes(child, out);
     }
 }
 
-static void save(const WalletsData &data, YAML::Node& node)
+static void save(const WalletsData &data, YAML::Emitter &out)
 {
-    save(data.rootItem, node);
+    out << YAML::BeginSeq;
+    saveNodes(data.rootItem, out);
+    out << YAML::EndSeq;
 }
 
 template <class T>
-static void save(const ArchNode<T> &data, YAML::Node& node)
+static void save(const ArchNode<T> &data, YAML::Emitter &out)
 {
+    out << YAML::BeginMap;
+
     bool valid = data.isValidPointer();
     if(valid) {
         const Node<T> *pointer = data.toPointer();
         if(pointer) {
-            node["ref"] = pointer->data.id.toString();
+            out << YAML::Key << "ref" << YAML::Value << codecs::formatUuid(pointer->data.id);
         } else {
-            node["ref"] = QUuid().toString();
+            out << YAML::Key << "ref" << YAML::Value << codecs::formatUuid(QUuid());
         }
     } else {
-        node["archive"] = data.toString();
+        out << YAML::Key << "archive" << YAML::Value << data.toString();
     }
+
+    out << YAML::EndMap;
 }
 
-static void save(const Transaction &t, YAML::Node& node)
+static void save(const Transaction &t, YAML::Emitter &out)
 {
-    node["date"] = t.date.toString(QStringLiteral("dd.MM.yyyy"));
+    out << YAML::BeginMap;
+
+    out << YAML::Key << "date" << YAML::Value << codecs::formatDate(t.date);
 
     if(!t.note.isEmpty()) {
-        node["note"] = t.note;
+        out << YAML::Key << "note" << YAML::Value << t.note.get();
     }
-    node["type"] = Transaction::Type::toConfigString(t.type);
+    out << YAML::Key << "type" << YAML::Value << codecs::transactionTypes.name(t.type);
 
-    YAML::Node category;
-    save(t.category, category);
     if(t.type != Transaction::Type::Transfer) {
-        node["category"] = category;
+        out << YAML::Key << "category" << YAML::Value;
+        save(t.category, out);
     }
-    node["amount"] = t.amount.as_cents();
-    YAML::Node from;
-    save(t.from, from);
-    YAML::Node to;
-    save(t.to, to);
+    out << YAML::Key << "amount" << YAML::Value << static_cast<long long>(t.amount.as_cents());
 
     if(t.type != Transaction::Type::In) {
-        node["from"] = from;
+        out << YAML::Key << "from" << YAML::Value;
+        save(t.from, out);
     }
 
     if(t.type != Transaction::Type::Out) {
-        node["to"] = to;
+        out << YAML::Key << "to" << YAML::Value;
+        save(t.to, out);
     }
+
+    out << YAML::EndMap;
 }
 
-static void save(const Plan &item, YAML::Node& node)
+static void save(const Plan &item, YAML::Emitter &out)
 {
+    out << YAML::BeginMap;
+
     if(!item.name.isEmpty()) {
-        node["name"] = item.name;
+        out << YAML::Key << "name" << YAML::Value << item.name;
     }
 
-    node["type"] = Transaction::Type::toConfigString(item.type);
+    out << YAML::Key << "type" << YAML::Value << Transaction::Type::toConfigString(item.type);
 
-    YAML::Node category;
-    save(item.category, category);
     if(item.type != Transaction::Type::Transfer) {
-        node["category"] = category;
+        out << YAML::Key << "category" << YAML::Value;
+        save(item.category, out);
     }
-    node["amount"] = item.amount.as_cents();
+    out << YAML::Key << "amount" << YAML::Value << static_cast<long long>(item.amount.as_cents());
+
+    out << YAML::EndMap;
 }
 
-static void save(const PlansTermData &data, YAML::Node& node)
+static void save(const PlansTermData &data, YAML::Emitter &out)
 {
-    for(const Plan &t : data.plans) {
-        YAML::Node obj;
-        save(t, obj);
-        node.push_back(obj);
-    }
+    saveSequence(data.plans, out);
 }
 
-static void save(const PlansData &data, YAML::Node& node)
+static void save(const PlansData &data, YAML::Emitter &out)
 {
-    YAML::Node shortPlans;
-    YAML::Node middlePlans;
-    YAML::Node longPlans;
+    out << YAML::BeginMap;
 
-    save(data.shortTerm, shortPlans);
-    save(data.middleTerm, middlePlans);
-    save(data.longTerm, longPlans);
+    out << YAML::Key << "short" << YAML::Value;
+    save(data.shortTerm, out);
+    out << YAML::Key << "middle" << YAML::Value;
+    save(data.middleTerm, out);
+    out << YAML::Key << "long" << YAML::Value;
+    save(data.longTerm, out);
 
-    node["short"] = shortPlans;
-    node["middle"] = middlePlans;
-    node["long"] = longPlans;
+    out << YAML::EndMap;
 }
 
-static void save(const Task &item, YAML::Node& node)
+static void save(const Task &item, YAML::Emitter &out)
 {
-    node["type"] = Transaction::Type::toConfigString(item.type);
+    out << YAML::BeginMap;
+
+    out << YAML::Key << "type" << YAML::Value << Transaction::Type::toConfigString(item.type);
 
-    YAML::Node category;
-    save(item.category, category);
     if(item.type != Transaction::Type::Transfer) {
-        node["category"] = category;
+        out << YAML::Key << "category" << YAML::Value;
+        save(item.category, out);
     }
-    node["from"] = item.from.toString(QStringLiteral("dd.MM.yyyy"));
-    node["to"] = item.to.toString(QStringLiteral("dd.MM.yyyy"));
-    node["amount"] = item.amount.as_cents();
+    out << YAML::Key << "from" << YAML::Value << codecs::formatDate(item.from);
+    out << YAML::Key << "to" << YAML::Value << codecs::formatDate(item.to);
+    out << YAML::Key << "amount" << YAML::Value << static_cast<long long>(item.amount.as_cents());
+
+    out << YAML::EndMap;
 }
 
-static void save(const TasksData &data, YAML::Node& node)
+static void save(const TasksData &data, YAML::Emitter &out)
 {
-    for(const auto& tasks : {data.active.tasks, data.completed.tasks}) {
-        for(const Task &task : tasks) {
-            YAML::Node obj;
-            save(task, obj);
-            node.push_back(obj);
+    if(data.active.tasks.empty() && data.completed.tasks.empty()) {
+        out << YAML::Null;
+        return;
+    }
+
+    out << YAML::BeginSeq;
+    for(const auto *tasks : {&data.active.tasks, &data.completed.tasks}) {
+        for(const Task &task : *tasks) {
+            save(task, out);
         }
     }
+    out << YAML::EndSeq;
 }
 
 static QString backupFile(const QString &originalFile, int number)
@@ -299,9 +426,9 @@ static QString backupFile(const QString &originalFile, int number)
     return QString("%1/%2/%3%4.%5").arg(filePath, storage::backupDir, fileBase, storage::backupExt, QString::number(number));
 }
 
-template <class ObjectOrArray>
-static void saveFile(const QString &fileName, ObjectOrArray data)
+static void saveFile(const QString &fileName, const YAML::Emitter &out)
 {
+    CASHBOOK_TRACE_SCOPE("saveFile", fileName);
     // 1. backup file
 
     // if storage::backupCount == 3 then
@@ -318,13 +445,75 @@ static void saveFile(const QString &fileName, ObjectOrArray data)
         aske::copyFileForced(fileName, backupFile(fileName, 1));
     }
 
-    // 2. save file
+    // 2. save file, text mode keeps platform line endings
     std::ofstream fout(fileName.toStdString());
-    fout << data;
+    fout.write(out.c_str(), static_cast<std::streamsize>(out.size()));
+}
+
+template <class Func>
+static void forEachInMonth(const LogData &data, const Month &month, Func func)
+{
+    for(const auto &[begin, end] : data.monthRanges(month)) {
+        for(size_t i = begin; i<end; ++i) {
+            func(data.log[i]);
+        }
+    }
+}
+
+static quint64 contentHash(const YAML::Emitter &out)
+{
+    return codecs::hash(std::string_view(out.c_str(), out.size()));
+}
+
+static void saveMonth(const LogData &data, const Month &month, YAML::Emitter &out)
+{
+    if(data.monthRanges(month).empty()) {
+        out << YAML::Null;
+    } else {
+        out << YAML::BeginSeq;
+        forEachInMonth(data, month, [&out](const Transaction &t) {
+            save(t, out);
+        });
+        out << YAML::EndSeq;
+    }
+}
+
+static void saveMonth(const LogData &data, const Month &month)
+{
+    YAML::Emitter out;
+    saveMonth(data, month, out);
+
+    saveFile(storage::monthFile(month.toDate()), out);
+}
+
+static void saveSegment(const LogData &data, const Month &month)
+{
+    SegmentWriter writer;
+    forEachInMonth(data, month, [&writer](const Transaction &t) {
+        writer.append(t);
+    });
+
+    // segment is not backed up: it always can be restored from `.pitm` file.
+    // Broken segment should not outlive the failed save
+    const QString fileName {storage::segmentFile(month.toDate())};
+    if(!writer.save(fileName)) {
+        QFile::remove(fileName);
+    }
+}
+
+/**
+ * Whether segment of `month` exists and is not older than its `.pitm` file,
+ * i.e. it would be loaded instead of the `.pitm` file.
+ */
+static bool isSegmentFresh(const Month &month)
+{
+    const QFileInfo segment(storage::segmentFile(month.toDate()));
+    return segment.exists() && !(segment.lastModified() < QFileInfo(storage::monthFile(month.toDate())).lastModified());
 }
 
 static void saveLog(Data &data)
 {
+    CASHBOOK_TRACE_SCOPE("saveLog");
     const auto &log = data.log.log;
     auto &changedMonths = data.log.changedMonths;
 
@@ -336,69 +525,160 @@ static void saveLog(Data &data)
         return;
     }
 
-    for(const Month &month : changedMonths) {
-        YAML::Node monthArray;
-        for(const Transaction &t : log) {
-            Month tMonth {t.date};
+    auto &hashes = data.log.monthHashes;
 
-            if(tMonth != month) {
-                continue;
+    for(const Month &month : changedMonths) {
+        const QString fileName {storage::monthFile(month.toDate())};
+
+        YAML::Emitter out;
+        saveMonth(data.log, month, out);
+
+        // month is marked as changed by any edit, even if it is reverted later.
+        // Skip both writing and backup rotation if the file would not change.
+        // Missing or stale segment is still written, `.pitm` file is left as is
+        const quint64 hash {contentHash(out)};
+        auto it = hashes.find(month);
+        if(it != hashes.end() && it->second == hash && QFileInfo::exists(fileName)) {
+            if(data.log.format == LogFormat::Segments && !isSegmentFresh(month)) {
+                saveSegment(data.log, month);
             }
-
-            YAML::Node obj;
-            save(t, obj);
-            monthArray.push_back(obj);
+            continue;
         }
 
-        saveFile(storage::monthFile(month.toDate()), monthArray);
+        hashes[month] = hash;
+
+        // segment goes last, so it is never older than `.pitm` file it mirrors
+        saveFile(fileName, out);
+        switch(data.log.format) {
+        case LogFormat::Yaml:
+            QFile::remove(storage::segmentFile(month.toDate()));
+            break;
+        case LogFormat::Segments:
+        case LogFormat::Count:
+            saveSegment(data.log, month);
+            break;
+        }
     }
 
     changedMonths.clear();
 }
 
-static void saveHead(const Data &data, YAML::Node& node)
+static void saveHashes(const std::map<Month, quint64> &hashes, YAML::Emitter &out)
 {
-    YAML::Node owners;
-    YAML::Node banks;
-    YAML::Node wallets;
-    YAML::Node inCategories;
-    YAML::Node outCategories;
-    YAML::Node plans;
-    YAML::Node tasks;
+    if(hashes.empty()) {
+        out << YAML::Null;
+        return;
+    }
 
-    save(data.owners, owners);
-    save(data.banks, banks);
-    save(data.wallets, wallets);
-    save(data.inCategories, inCategories);
-    save(data.outCategories, outCategories);
-    save(data.plans, plans);
-    save(data.tasks, tasks);
+    out << YAML::BeginMap;
+    for(const auto &[month, hash] : hashes) {
+        out << YAML::Key << month.toDate().toString(storage::dateFormat);
+        out << YAML::Value << QString::number(hash, 16);
+    }
+    out << YAML::EndMap;
+}
 
-    node["owners"] = owners;
-    node["banks"] = banks;
-    node["wallets"] = wallets;
-    node["inCategories"] = inCategories;
-    node["outCategories"] = outCategories;
-    node["plans"] = plans;
-    node["tasks"] = tasks;
-    node["unanchored"] = data.log.unanchored;
+static void saveHead(const Data &data, YAML::Emitter &out)
+{
+    out << YAML::BeginMap;
+
+    out << YAML::Key << "owners" << YAML::Value;
+    save(data.owners, out);
+    out << YAML::Key << "banks" << YAML::Value;
+    save(data.banks, out);
+    out << YAML::Key << "wallets" << YAML::Value;
+    save(data.wallets, out);
+    out << YAML::Key << "inCategories" << YAML::Value;
+    save(data.inCategories, out);
+    out << YAML::Key << "outCategories" << YAML::Value;
+    save(data.outCategories, out);
+    out << YAML::Key << "plans" << YAML::Value;
+    save(data.plans, out);
+    out << YAML::Key << "tasks" << YAML::Value;
+    save(data.tasks, out);
+    out << YAML::Key << "unanchored" << YAML::Value << data.log.unanchored;
+    out << YAML::Key << "logFormat" << YAML::Value << codecs::logFormats.name(data.log.format);
+    out << YAML::Key << "hashes" << YAML::Value;
+    saveHashes(data.log.monthHashes, out);
+
+    out << YAML::EndMap;
 }
 
 static void saveHead(const Data &data)
 {
-    YAML::Node node;
-    saveHead(data, node);
+    CASHBOOK_TRACE_SCOPE("saveHead");
+    YAML::Emitter out;
+    saveHead(data, out);
+
+    saveFile(storage::headFile, out);
+}
+
+/**
+ * Writes derived values of just saved log. Month which is not loaded keeps
+ * its cached values, if it has any.
+ */
+static void saveCache(const Data &data)
+{
+    CASHBOOK_TRACE_SCOPE("saveCache");
+    cache::Snapshot snapshot;
+    snapshot.trees = cache::treesHash(data);
 
-    saveFile(storage::headFile, node);
+    std::map<Month, const StoredMonth *> storedMonths;
+    for(const auto &storedMonth : data.log.storedMonths) {
+        storedMonths[storedMonth->month] = storedMonth.get();
+    }
+
+    for(const MonthFile &file : listMonthFiles()) {
+        cache::MonthEntry entry;
+        entry.yaml = file.yamlStamp;
+        entry.segment = file.segmentStamp;
+        entry.normalized = data.log.normalizedMonths.count(file.month) > 0;
+
+        auto it = storedMonths.find(file.month);
+        if(it == storedMonths.end()) {
+            forEachInMonth(data.log, file.month, [&entry](const Transaction &t) {
+                entry.brief.add(t);
+            });
+        } else if(it->second->brief) {
+            entry.brief = *it->second->brief;
+        } else {
+            continue;
+        }
+
+        snapshot.months.emplace(file.month, std::move(entry));
+    }
+
+    // task is only summed if the log is loaded for its whole period
+    for(const auto *tasks : {&data.tasks.active.tasks, &data.tasks.completed.tasks}) {
+        for(const Task &task : *tasks) {
+            if(!data.log.isLoadedSince(task.from)) {
+                continue;
+            }
+
+            Task summed {task};
+            data.log.updateTask(summed);
+            snapshot.tasks.push_back(cache::taskEntry(summed));
+        }
+    }
+
+    if(!cache::save(snapshot, storage::cacheFile)) {
+        QFile::remove(storage::cacheFile);
+    }
 }
 
 void save(Data &data)
 {
+    CASHBOOK_TRACE_SCOPE("save");
     // make sure that we have existing root and backup directories (i.e. "data/backup")
     QDir().mkpath(QString("%1/%2").arg(storage::rootDir, storage::backupDir));
 
-    saveHead(data);
+    // head goes last, so it stores hashes of just saved months
     saveLog(data);
+    saveHead(data);
+    saveCache(data);
+
+    // notes of removed or edited rows are not referenced anymore
+    StringPool::collect();
 }
 
 //
@@ -406,8 +686,7 @@ void save(Data &data)
 //
 static void load(IdableString &data, const YAML::Node& node)
 {
-    QString id = node["id"].as<QString>();
-    data.id = QUuid(id);
+    data.id = codecs::parseUuid(node["id"].Scalar());
     static_cast<QString &>(data) = node["str"].as<QString>();
 }
 
@@ -453,21 +732,17 @@ static void load(CategoriesData &data, const YAML::Node& node)
     }
 }
 
-template <class T, class Model>
-static void load(ArchPointer<T> &data, const YAML::Node& node, const Model &model)
+template <class T>
+static void load(ArchPointer<T> &data, const YAML::Node& node, const IdIndex<T> &ids)
 {
     const YAML::Node& refNode = node["ref"];
 
     if(refNode.IsDefined()){
-        QString id = refNode.as<QString>();
-        QUuid uid = QUuid{id};
+        QUuid uid = codecs::parseUuid(refNode.Scalar());
 
         if(!uid.isNull()) {
-            for(const T &el : model) {
-                if(el.id == uid) {
-                    data = &el;
-                    return;
-                }
+            if(const T *el = ids.find(uid)) {
+                data = el;
             }
         } else {
             data = static_cast<const Owner*>(nullptr);
@@ -479,11 +754,13 @@ static void load(ArchPointer<T> &data, const YAML::Node& node, const Model &mode
 
 static void load(Wallet &wallet, const YAML::Node& node, const OwnersData &owners, const BanksData &banks)
 {
-    QString id = node["id"].as<QString>();
-    wallet.id = QUuid(id);
-    wallet.type = Wallet::Type::fromConfigString( node["type"].as<QString>() );
+    wallet.id = codecs::parseUuid(node["id"].Scalar());
+    wallet.type = codecs::walletTypes.fromName(node["type"].Scalar());
     wallet.name = node["name"].as<QString>();
-    wallet.amount = Money(static_cast<intmax_t>(node["amount"].as<double>()));
+
+    qint64 amount = 0;
+    codecs::parseCents(node["amount"].Scalar(), amount);
+    wallet.amount = Money(static_cast<intmax_t>(amount));
 
     switch(wallet.type)
     {
@@ -501,7 +778,7 @@ static void load(Wallet &wallet, const YAML::Node& node, const OwnersData &owner
             info->incomePercent = node["incomePercent"].as<float>();
 
             const YAML::Node& bankObj = node["bank"];
-            load(info->bank, bankObj, banks.banks);
+            load(info->bank, bankObj, banks.ids);
 
             wallet.info = std::move(info);
         }
@@ -510,7 +787,7 @@ static void load(Wallet &wallet, const YAML::Node& node, const OwnersData &owner
         {
             auto info = std::make_shared<Wallet::AccountInfo>();
             const YAML::Node& bankObj = node["bank"];
-            load(info->bank, bankObj, banks.banks);
+            load(info->bank, bankObj, banks.ids);
 
             wallet.info = std::move(info);
         }
@@ -519,7 +796,7 @@ static void load(Wallet &wallet, const YAML::Node& node, const OwnersData &owner
         {
             auto info = std::make_shared<Wallet::CardInfo>();
             const YAML::Node& bankObj = node["bank"];
-            load(info->bank, bankObj, banks.banks);
+            load(info->bank, bankObj, banks.ids);
 
             wallet.info = std::move(info);
         }
@@ -527,12 +804,12 @@ static void load(Wallet &wallet, const YAML::Node& node, const OwnersData &owner
         case Wallet::Type::Investment:
         {
             auto info = std::make_shared<Wallet::InvestmentInfo>();
-            info->type = Wallet::InvestmentInfo::Type::fromConfigString(node["investmentType"].as<QString>());
+            info->type = codecs::investmentTypes.fromName(node["investmentType"].Scalar());
 
             const YAML::Node& investmentank = node["bank"];
             if(investmentank.IsDefined()) {
                 info->account = Wallet::AccountInfo();
-                load(info->account->bank, investmentank, banks.banks);
+                load(info->account->bank, investmentank, banks.ids);
             }
             wallet.info = std::move(info);
         }
@@ -546,12 +823,12 @@ static void load(Wallet &wallet, const YAML::Node& node, const OwnersData &owner
     }
 
     const YAML::Node& ownerObj = node["owner"];
-    load(wallet.info->owner, ownerObj, owners.owners);
+    load(wallet.info->owner, ownerObj, owners.ids);
     wallet.info->canBeNegative = node["canBeNegative"].as<bool>();
 
     const YAML::Node& availability = node["availability"];
     if(availability.IsDefined()) {
-        wallet.info->availability = Wallet::Availability::fromConfigString(node["availability"].as<QString>());
+        wallet.info->availability = codecs::availabilities.fromName(node["availability"].Scalar());
     }
 }
 
@@ -578,22 +855,17 @@ static void load(WalletsData &data, const YAML::Node& arr, const OwnersData &own
     }
 }
 
-template <class T, class Model>
-static void load(ArchNode<T> &data, const YAML::Node& node, const Model &refModel)
+template <class T>
+static void load(ArchNode<T> &data, const YAML::Node& node, const TreeData<T> &refModel)
 {
     const YAML::Node& refNode = node["ref"];
 
     if(refNode.IsDefined()){
-        QString id = refNode.as<QString>();
-        QUuid uid = QUuid{id};
+        QUuid uid = codecs::parseUuid(refNode.Scalar());
 
         if(!uid.isNull()) {
-            auto nodes = refModel.rootItem->toList();
-            for(const Node<T> *obj : nodes) {
-                if(obj->data.id == uid) {
-                    data = obj;
-                    return;
-                }
+            if(const Node<T> *obj = refModel.ids.find(uid)) {
+                data = obj;
             }
         } else {
             data = static_cast<const Node<T>*>(nullptr);
@@ -603,61 +875,353 @@ static void load(ArchNode<T> &data, const YAML::Node& node, const Model &refMode
     }
 }
 
-static void load(Transaction &t, const YAML::Node& node,
-                 const WalletsData &wallets,
-                 const CategoriesData &inCategories,
-                 const CategoriesData &outCategories
-) {
-    t.date = QDate::fromString(node["date"].as<QString>(), "dd.MM.yyyy");
-    t.note = node["note"].as<QString>("");
-    t.type = Transaction::Type::fromConfigString( node["type"].as<QString>() );
-    t.amount = Money(static_cast<intmax_t>(node["amount"].as<int>()));
+/**
+ * @brief Reference as it is written in a month file.
+ */
+struct RawReference
+{
+    enum class Kind {
+        None,
+        Ref,
+        Archive
+    };
+
+    Kind kind {Kind::None};
+    std::string value;
+};
+
+/**
+ * @brief Transaction as it is written in a month file.
+ * @details Category can be resolved only when transaction's type is known,
+ *          and keys may go in any order. So references are resolved when the
+ *          whole record is read.
+ */
+struct RawTransaction
+{
+    std::string date;
+    std::string note;
+    std::string type;
+    std::string amount;
+    RawReference category;
+    RawReference from;
+    RawReference to;
+};
+
+/**
+ * @brief Reads month file right from parser events, without building
+ *        `YAML::Node` tree.
+ * @details Month file is a sequence of transaction maps with optional
+ *          reference maps inside. Values of unknown keys are skipped, any
+ *          other shape or a transaction without `date`, `type` or `amount`
+ *          throws `YAML::ParserException`, as loading of a `YAML::Node` did.
+ *          Every complete record is passed to `sink`.
+ */
+template <class Sink>
+class MonthEventHandler : public YAML::EventHandler
+{
+public:
+    explicit MonthEventHandler(Sink &sink)
+        : m_sink(sink)
+    {}
 
-    if(t.type != Transaction::Type::Transfer) {
-        const YAML::Node& categoryObj = node["category"];
-        ArchNode<Category> category;
-        if(t.type == Transaction::Type::In) {
-            load(category, categoryObj, inCategories);
-        } else if(t.type == Transaction::Type::Out) {
-            load(category, categoryObj, outCategories);
+    void OnDocumentStart(const YAML::Mark &) override {}
+    void OnDocumentEnd() override {}
+
+    void OnNull(const YAML::Mark &mark, YAML::anchor_t) override {
+        onScalar(mark, nullptr);
+    }
+
+    void OnAlias(const YAML::Mark &mark, YAML::anchor_t) override {
+        onScalar(mark, nullptr);
+    }
+
+    void OnScalar(const YAML::Mark &mark, const std::string &, YAML::anchor_t, const std::string &value) override {
+        onScalar(mark, &value);
+    }
+
+    void OnSequenceStart(const YAML::Mark &mark, const std::string &, YAML::anchor_t, YAML::EmitterStyle::value) override {
+        onCollectionStart(mark, false);
+    }
+
+    void OnSequenceEnd() override {
+        onCollectionEnd();
+    }
+
+    void OnMapStart(const YAML::Mark &mark, const std::string &, YAML::anchor_t, YAML::EmitterStyle::value) override {
+        onCollectionStart(mark, true);
+    }
+
+    void OnMapEnd() override {
+        onCollectionEnd();
+    }
+
+private:
+    enum Depth {
+        InDocument = 0,
+        InMonth,
+        InRecord,
+        InReference,
+    };
+
+    enum Field {
+        Date = 1 << 0,
+        Type = 1 << 1,
+        Amount = 1 << 2,
+
+        Required = Date | Type | Amount
+    };
+
+    [[noreturn]] static void fail(const YAML::Mark &mark, const std::string &message)
+    {
+        throw YAML::ParserException(mark, message);
+    }
+
+    RawReference *reference(const std::string &key)
+    {
+        if(key == "category") return &m_record.category;
+        if(key == "from") return &m_record.from;
+        if(key == "to") return &m_record.to;
+        return nullptr;
+    }
+
+    static void assign(std::string &str, const std::string *value)
+    {
+        if(value) {
+            str = *value;
+        } else {
+            str.clear();
         }
-        t.category = category;
     }
 
-    if(t.type != Transaction::Type::In) {
-        const YAML::Node& from = node["from"];
-        load(t.from, from, wallets);
+    std::string *field(const std::string &key)
+    {
+        if(key == "date") return &m_record.date;
+        if(key == "note") return &m_record.note;
+        if(key == "type") return &m_record.type;
+        if(key == "amount") return &m_record.amount;
+        return nullptr;
     }
 
-    if(t.type != Transaction::Type::Out) {
-        const YAML::Node& to = node["to"];
-        load(t.to, to, wallets);
+    static int requiredField(const std::string &key)
+    {
+        if(key == "date") return Date;
+        if(key == "type") return Type;
+        if(key == "amount") return Amount;
+        return 0;
     }
-}
 
-static void load(LogData &log, const YAML::Node& node, Data &data){
-    for (const YAML::Node& tObj : node) {
-        Transaction t;
-        load(t, tObj, data.wallets, data.inCategories, data.outCategories);
+    void onScalar(const YAML::Mark &mark, const std::string *value)
+    {
+        if(m_skip) {
+            return;
+        }
 
-        if(t.type == Transaction::Type::In || t.type == Transaction::Type::Out) {
-            // update brief statistics
+        switch(m_depth) {
+        case InDocument:
+            // empty month is saved as null
+            if(value) {
+                fail(mark, "month should be a sequence of transactions");
+            }
+            break;
+        case InMonth:
+            fail(mark, "transaction should be a map");
+        case InRecord:
+            if(m_expectKey) {
+                if(!value) {
+                    fail(mark, "transaction key should be a scalar");
+                }
+                m_key = *value;
+            } else if(std::string *f = field(m_key)) {
+                assign(*f, value);
+                if(value) {
+                    m_fields |= requiredField(m_key);
+                }
+            }
+            m_expectKey = !m_expectKey;
+            break;
+        case InReference:
+            if(m_expectKey) {
+                assign(m_key, value);
+            } else if(m_key == "ref") {
+                m_reference->kind = RawReference::Kind::Ref;
+                assign(m_reference->value, value);
+            } else if(m_key == "archive" && m_reference->kind != RawReference::Kind::Ref) {
+                // `ref` wins if both keys are present
+                m_reference->kind = RawReference::Kind::Archive;
+                assign(m_reference->value, value);
+            }
+            m_expectKey = !m_expectKey;
+            break;
+        }
+    }
 
-            Month month(t.date);
-            const auto &archNode = t.category;
-            const bool isRegular = archNode.isValidPointer() && archNode.toPointer() && archNode.toPointer()->data.regular;
+    void onCollectionStart(const YAML::Mark &mark, bool map)
+    {
+        if(m_skip) {
+            ++m_skip;
+            return;
+        }
 
-            BriefStatisticsRecord& monthBrief = log.statistics.brief[month];
+        switch(m_depth) {
+        case InDocument:
+            if(map) {
+                fail(mark, "month should be a sequence of transactions");
+            }
+            m_depth = InMonth;
+            return;
+        case InMonth:
+            if(!map) {
+                fail(mark, "transaction should be a map");
+            }
+            m_record = RawTransaction();
+            m_recordMark = mark;
+            m_fields = 0;
+            m_depth = InRecord;
+            m_expectKey = true;
+            return;
+        case InRecord:
+            if(m_expectKey) {
+                fail(mark, "transaction key should be a scalar");
+            }
+            if(map) {
+                m_reference = reference(m_key);
+                if(m_reference) {
+                    *m_reference = RawReference();
+                    m_depth = InReference;
+                    m_expectKey = true;
+                    return;
+                }
+            }
+            if(field(m_key) || reference(m_key)) {
+                fail(mark, "unexpected value of '" + m_key + "'");
+            }
+            break;
+        case InReference:
+            if(m_expectKey) {
+                fail(mark, "reference key should be a scalar");
+            }
+            if(m_key == "ref" || m_key == "archive") {
+                fail(mark, "unexpected value of '" + m_key + "'");
+            }
+            break;
+        }
 
-            Money& common = t.type == Transaction::Type::In ? monthBrief.common.received : monthBrief.common.spent;
-            common += t.amount;
-            if(isRegular) {
-                Money& regular = t.type == Transaction::Type::In ? monthBrief.regular.received : monthBrief.regular.spent;
-                regular += t.amount;
+        // value of unknown key
+        m_skip = 1;
+    }
+
+    void onCollectionEnd()
+    {
+        if(m_skip) {
+            // skipped collection took place of a value
+            if(--m_skip == 0) {
+                m_expectKey = !m_expectKey;
             }
+            return;
         }
 
-        log.log.emplace_back(std::move(t));
+        switch(m_depth) {
+        case InReference:
+            m_depth = InRecord;
+            m_expectKey = true;
+            break;
+        case InRecord:
+            if((m_fields & Required) != Required) {
+                fail(m_recordMark, "transaction should have date, type and amount");
+            }
+            m_sink(m_record);
+            m_depth = InMonth;
+            break;
+        case InMonth:
+            m_depth = InDocument;
+            break;
+        default:
+            break;
+        }
+    }
+
+    Sink &m_sink;
+
+    int m_depth {InDocument};
+    int m_skip {0};
+    bool m_expectKey {true};
+    std::string m_key;
+
+    RawTransaction m_record;
+    YAML::Mark m_recordMark;
+    int m_fields {0};
+    RawReference *m_reference {nullptr};
+};
+
+template <class Sink>
+static void parseMonth(const QString &filePath, Sink sink)
+{
+    std::ifstream fin(filePath.toStdString(), std::ios::binary);
+    if(!fin) {
+        throw YAML::BadFile(filePath.toStdString());
+    }
+
+    YAML::Parser parser(fin);
+    MonthEventHandler<Sink> handler(sink);
+    parser.HandleNextDocument(handler);
+}
+
+template <class T>
+static void load(ArchNode<T> &data, const RawReference &ref, const TreeData<T> &refModel)
+{
+    switch(ref.kind) {
+    case RawReference::Kind::None:
+        break;
+    case RawReference::Kind::Ref: {
+        QUuid uid = codecs::parseUuid(ref.value);
+
+        if(!uid.isNull()) {
+            if(const Node<T> *obj = refModel.ids.find(uid)) {
+                data = obj;
+            }
+        } else {
+            data = static_cast<const Node<T>*>(nullptr);
+        }
+    } break;
+    case RawReference::Kind::Archive:
+        data = ArchiveString(QString::fromStdString(ref.value));
+        break;
+    }
+}
+
+static void load(Transaction &t, const RawTransaction &raw, const Data &data)
+{
+    t.date = codecs::parseDate(raw.date);
+    t.note = QString::fromStdString(raw.note);
+    t.type = codecs::transactionTypes.fromName(raw.type);
+
+    qint64 amount = 0;
+    codecs::parseCents(raw.amount, amount);
+    t.amount = Money(static_cast<intmax_t>(amount));
+
+    if(t.type == Transaction::Type::In) {
+        load(t.category, raw.category, data.inCategories);
+    } else if(t.type == Transaction::Type::Out) {
+        load(t.category, raw.category, data.outCategories);
+    }
+
+    if(t.type != Transaction::Type::In) {
+        load(t.from, raw.from, data.wallets);
+    }
+
+    if(t.type != Transaction::Type::Out) {
+        load(t.to, raw.to, data.wallets);
+    }
+}
+
+static void load(MonthLog &monthLog, const std::vector<RawTransaction> &records, const Data &data)
+{
+    monthLog.transactions.reserve(records.size());
+
+    for(const RawTransaction &raw : records) {
+        Transaction t;
+        load(t, raw, data);
+        monthLog.append(std::move(t));
     }
 }
 
@@ -666,7 +1230,7 @@ static void load(Plan &item, const YAML::Node& node,
                  const CategoriesData &outCategories
 ) {
     item.name = node["name"].as<QString>();
-    item.type = Transaction::Type::fromConfigString( node["type"].as<QString>() );
+    item.type = codecs::transactionTypes.fromName(node["type"].Scalar());
 
     if(item.type != Transaction::Type::Transfer) {
         const YAML::Node& categoryObj = node["category"];
@@ -679,7 +1243,9 @@ static void load(Plan &item, const YAML::Node& node,
         item.category = category;
     }
 
-    item.amount = Money(static_cast<intmax_t>(node["amount"].as<int>()));
+    qint64 amount = 0;
+    codecs::parseCents(node["amount"].Scalar(), amount);
+    item.amount = Money(static_cast<intmax_t>(amount));
 }
 
 static void load(PlansTermData &data, const YAML::Node& arr,
@@ -708,7 +1274,7 @@ static void load(Task &item, const YAML::Node& node,
                  const CategoriesData &inCategories,
                  const CategoriesData &outCategories
 ) {
-    item.type = Transaction::Type::fromConfigString( node["type"].as<QString>() );
+    item.type = codecs::transactionTypes.fromName(node["type"].Scalar());
 
     if(item.type != Transaction::Type::Transfer) {
         const YAML::Node& categoryObj = node["category"];
@@ -721,10 +1287,12 @@ static void load(Task &item, const YAML::Node& node,
         item.category = category;
     }
 
-    item.from = QDate::fromString(node["from"].as<QString>(), "dd.MM.yyyy");
-    item.to = QDate::fromString(node["to"].as<QString>(), "dd.MM.yyyy");
+    item.from = codecs::parseDate(node["from"].Scalar());
+    item.to = codecs::parseDate(node["to"].Scalar());
 
-    item.amount = Money(static_cast<intmax_t>(node["amount"].as<int>()));
+    qint64 amount = 0;
+    codecs::parseCents(node["amount"].Scalar(), amount);
+    item.amount = Money(static_cast<intmax_t>(amount));
 }
 
 static void load(TasksData &data, const YAML::Node& arr,
@@ -743,60 +1311,240 @@ static void load(TasksData &data, const YAML::Node& arr,
     }
 }
 
+static void load(std::map<Month, quint64> &hashes, const YAML::Node& node)
+{
+    for(const auto &pair : node) {
+        const QDate month {QDate::fromString(pair.first.as<QString>(), storage::dateFormat)};
+
+        bool ok {false};
+        const quint64 hash {pair.second.as<QString>().toULongLong(&ok, 16)};
+
+        if(month.isValid() && ok) {
+            hashes[Month(month)] = hash;
+        }
+    }
+}
+
 static void loadHead(Data &data, const YAML::Node& node)
 {
     load(data.owners, node["owners"]);
+    data.owners.rebuildIndex();
     load(data.banks, node["banks"]);
+    data.banks.rebuildIndex();
     load(data.wallets, node["wallets"], data.owners, data.banks);
+    data.wallets.rebuildIndex();
     load(data.inCategories, node["inCategories"]);
+    data.inCategories.rebuildIndex();
     load(data.outCategories, node["outCategories"]);
+    data.outCategories.rebuildIndex();
     load(data.plans, node["plans"], data.inCategories, data.outCategories);
     load(data.tasks, node["tasks"], data.inCategories, data.outCategories);
     data.log.unanchored = node["unanchored"].as<int>();
+
+    const YAML::Node& logFormat = node["logFormat"];
+    if(logFormat.IsDefined()) {
+        data.log.format = codecs::logFormats.fromName(logFormat.Scalar());
+    }
+    load(data.log.monthHashes, node["hashes"]);
 }
 
-static void loadMonth(Data &data, const YAML::Node& node)
+static void loadMonth(MonthLog &monthLog, const QString &filePath, const Data &data)
 {
-    load(data.log, node, data);
+    parseMonth(filePath, [&monthLog, &data](const RawTransaction &raw) {
+        Transaction t;
+        load(t, raw, data);
+        monthLog.append(std::move(t));
+    });
 }
 
-static void loadLog(Data &data, int recentMonths = -1) /* (recentMonths == -1) means load all */
-{    
-    QDir dir(storage::rootDir, {QStringLiteral("*")+storage::ext});
-    dir.setFilter(QDir::Files);
-    dir.setSorting(QDir::Name | QDir::Reversed);
+static void loadMonth(MonthFile &month, const Data &data)
+{
+    CASHBOOK_TRACE_SCOPE("loadMonth", month.segmentPath.isEmpty() ? month.yamlPath : month.segmentPath);
+    if(!month.segmentPath.isEmpty() && loadSegment(month.log, month.segmentPath, data)) {
+        return;
+    }
+
+    if(!month.yamlPath.isEmpty()) {
+        loadMonth(month.log, month.yamlPath, data);
+    }
+}
+
+/**
+ * @brief Month file which is loaded on demand.
+ */
+class StoredMonthFile : public StoredMonth
+{
+public:
+    StoredMonthFile(MonthFile &&file, const Data &data)
+        : StoredMonth(file.month)
+        , m_file(std::move(file))
+        , m_data(data)
+    {}
+
+    void read() override
+    {
+        CASHBOOK_TRACE_SCOPE("readStoredMonth", m_file.segmentPath.isEmpty() ? m_file.yamlPath : m_file.segmentPath);
+        if(!m_file.segmentPath.isEmpty()) {
+            // segment is mapped, not copied: `take()` decodes it right from the mapping
+            m_segmentFile.setFileName(m_file.segmentPath);
+            if(m_segmentFile.open(QIODevice::ReadOnly)) {
+                const qint64 size = m_segmentFile.size();
+                m_mapped = m_segmentFile.map(0, size);
+                if(m_mapped) {
+                    m_segment = QByteArray::fromRawData(reinterpret_cast<const char *>(m_mapped), static_cast<qsizetype>(size));
+                    return;
+                }
+            }
+        }
+
+        readYaml();
+    }
 
-    QFileInfoList files = dir.entryInfoList();
+    MonthLog take() override
     {
-        QMutableListIterator<QFileInfo> it(files);
-        while (it.hasNext()) {
-            if (it.next().filePath() == storage::headFile) {
-                it.remove();
+        CASHBOOK_TRACE_SCOPE("takeStoredMonth");
+        MonthLog monthLog;
+
+        if(m_segment.isEmpty() || !loadSegment(monthLog, m_segment, m_data)) {
+            // segment is broken, parse `.pitm` file right here
+            if(!m_yamlRead) {
+                readYaml();
             }
+
+            load(monthLog, m_records, m_data);
+        }
+
+        if(m_mapped) {
+            m_segment.clear(); // refers to the mapping
+            m_segmentFile.unmap(m_mapped);
+            m_mapped = nullptr;
+        }
+
+        if(brief) {
+            monthLog.brief.clear();
+        }
+
+        return monthLog;
+    }
+
+private:
+    void readYaml()
+    {
+        if(!m_file.yamlPath.isEmpty()) {
+            parseMonth(m_file.yamlPath, [this](RawTransaction &raw) {
+                m_records.push_back(std::move(raw));
+            });
+        }
+        m_yamlRead = true;
+    }
+
+    MonthFile m_file;
+    const Data &m_data;
+
+    QFile m_segmentFile;
+    uchar *m_mapped {nullptr};
+    QByteArray m_segment;
+    std::vector<RawTransaction> m_records;
+    bool m_yamlRead {false};
+};
+
+/**
+ * Entries of the snapshot which still describe month files on disk.
+ */
+static std::map<Month, cache::MonthEntry> validCacheEntries(cache::Snapshot &snapshot, const std::vector<MonthFile> &months, const Data &data)
+{
+    std::map<Month, cache::MonthEntry> res;
+
+    if(snapshot.trees != cache::treesHash(data)) {
+        return res;
+    }
+
+    for(const MonthFile &file : months) {
+        auto it = snapshot.months.find(file.month);
+        if(it != snapshot.months.end() && it->second.yaml == file.yamlStamp && it->second.segment == file.segmentStamp) {
+            res.insert(std::move(*it));
+        }
+    }
+
+    return res;
+}
+
+static void loadLog(Data &data, int recentMonths = -1) /* (recentMonths == -1) means load all */
+{    
+    CASHBOOK_TRACE_SCOPE("loadLog");
+    std::vector<MonthFile> months {listMonthFiles()};
+
+    // head is saved after months, so a month file which is newer than the head
+    // was edited by hand and its saved hash does not describe it anymore
+    const QDateTime headModified {QFileInfo(storage::headFile).lastModified()};
+    for(const MonthFile &month : months) {
+        if(month.yamlPath.isEmpty() || month.yamlModified > headModified) {
+            data.log.monthHashes.erase(month.month);
         }
     }
 
-    if(recentMonths == -1) {
-        recentMonths = INT_MAX;
+    cache::Snapshot snapshot;
+    cache::load(snapshot, storage::cacheFile);
+
+    std::map<Month, cache::MonthEntry> cached {validCacheEntries(snapshot, months, data)};
+    const bool allCached = cached.size() == months.size() && snapshot.months.size() == months.size();
+
+    for(const auto &[month, entry] : cached) {
+        if(entry.normalized) {
+            data.log.normalizedMonths.insert(month);
+        }
     }
 
-    const qsizetype n = files.size();
-    qsizetype i = 0;
+    if(recentMonths >= 0 && months.size() > static_cast<size_t>(recentMonths)) {
+        // older months are paged in by `LogModel` when they are needed.
+        // Their brief statistics are known right away if they are cached
+        for(auto it = std::next(months.begin(), recentMonths); it != months.end(); ++it) {
+            auto storedMonth = std::make_unique<StoredMonthFile>(std::move(*it), data);
+
+            auto entry = cached.find(storedMonth->month);
+            if(entry != cached.end()) {
+                data.statistics.brief.merge(entry->second.brief);
+                storedMonth->brief = std::move(entry->second.brief);
+            }
+
+            data.log.storedMonths.push_back(std::move(storedMonth));
+        }
+        months.resize(static_cast<size_t>(recentMonths));
+    }
 
-    while (i < n && i <= recentMonths) {
-        const QFileInfo& file = files[static_cast<int>(i++)];
+    // month files do not depend on each other, so they are parsed on the global
+    // thread pool. Wallets and categories trees are only read at this point.
+    QtConcurrent::blockingMap(months, [&data](MonthFile &month) {
+        loadMonth(month, data);
+    });
 
-        auto filePath = file.filePath();
+    // files are sorted newest first, so appending them in order keeps the log sorted
+    for(MonthFile &month : months) {
+        data.log.appendMonthLog(std::move(month.log));
+    }
 
-        YAML::Node monthDoc = YAML::LoadFile(filePath.toStdString());
-        loadMonth(data, monthDoc);
+    // tasks are summed over the whole log, so cached sums are only valid
+    // if none of month files has changed
+    for(auto *tasks : {&data.tasks.active.tasks, &data.tasks.completed.tasks}) {
+        for(Task &task : *tasks) {
+            const cache::TaskEntry *entry {allCached ? snapshot.findTask(task) : nullptr};
+            if(entry) {
+                task.spent = entry->spent;
+                task.rest = task.amount - task.spent;
+            } else {
+                data.log.updateTask(task);
+            }
+        }
     }
 
-    data.updateTasks();
+    if(!allCached) {
+        saveCache(data);
+    }
 }
 
 static void loadHead(Data &data)
 {
+    CASHBOOK_TRACE_SCOPE("loadHead");
     QFileInfo info(storage::headFile);
     if(!info.exists()) {
         return;
@@ -806,14 +1554,42 @@ static void loadHead(Data &data)
     loadHead(data, doc);
 }
 
-void load(Data &data)
+void load(Data &data, int recentMonths)
 {
+    CASHBOOK_TRACE_SCOPE("load");
     data.clear();
 
-    constexpr int LoadMonths = -1;
-
     loadHead(data);
-    loadLog(data, LoadMonths);
+    loadLog(data, recentMonths);
+}
+
+void convertLog(Data &data, LogFormat format)
+{
+    CASHBOOK_TRACE_SCOPE("convertLog");
+    load(data);
+
+    QDir().mkpath(QString("%1/%2").arg(storage::rootDir, storage::backupDir));
+
+    std::set<Month> months;
+    for(const Transaction &t : data.log.log) {
+        months.insert(Month(t.date));
+    }
+
+    for(const Month &month : months) {
+        switch(format) {
+        case LogFormat::Yaml:
+            saveMonth(data.log, month);
+            QFile::remove(storage::segmentFile(month.toDate()));
+            break;
+        case LogFormat::Segments:
+        case LogFormat::Count:
+            saveSegment(data.log, month);
+            break;
+        }
+    }
+
+    data.log.format = format;
+    saveHead(data);
 }
 
 } // namespace cashbook
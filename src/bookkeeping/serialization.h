@@ -7,9 +7,24 @@ namespace cashbook
 {
 
 class Data;
+enum class LogFormat;
 
 void save(Data &data);
-void load(Data &data);
+
+/**
+ * Loads head and `recentMonths` latest months of the log, or the whole log
+ * if `recentMonths` is `-1`. The rest of months are left in
+ * `LogData::storedMonths` to be loaded on demand.
+ */
+void load(Data &data, int recentMonths = -1);
+
+/**
+ * Reloads `data` and rewrites every month of the log in `format`.
+ * Conversion to `LogFormat::Yaml` regenerates `.pitm` files from loaded
+ * months and removes segments. The format is kept in the head file, so
+ * later saves write months the same way.
+ */
+void convertLog(Data &data, LogFormat format);
 
 } // namespace cashbook
 
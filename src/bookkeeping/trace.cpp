@@ -0,0 +1,149 @@
+#include "trace.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QCoreApplication>
+
+#include <atomic>
+#include <vector>
+
+namespace cashbook
+{
+
+namespace trace
+{
+
+struct Event
+{
+    const char *name;
+    QString detail;
+    qint64 begin; // nsecs since `start()`
+    qint64 duration;
+    int thread;
+};
+
+static constexpr size_t flushThreshold {4096}; // events kept in memory before they are written
+
+static std::atomic<bool> enabled {false};
+static QElapsedTimer timer;
+static QFile output;
+static bool firstEvent {true};
+static QMutex mutex;
+static std::vector<Event> events;
+static std::atomic<int> threadCount {0};
+
+static int threadIndex()
+{
+    // small numbers read better in the viewer than native thread ids
+    thread_local const int index {threadCount++};
+    return index;
+}
+
+// `mutex` should be locked
+static void flush()
+{
+    const qint64 pid {static_cast<qint64>(QCoreApplication::applicationPid())};
+
+    for(const Event &event : events) {
+        QJsonObject object {
+            {"name", QString::fromLatin1(event.name)},
+            {"ph", "X"},
+            {"ts", static_cast<double>(event.begin) / 1000.0},
+            {"dur", static_cast<double>(event.duration) / 1000.0},
+            {"pid", pid},
+            {"tid", event.thread},
+        };
+
+        if(!event.detail.isEmpty()) {
+            object.insert("args", QJsonObject {{"detail", event.detail}});
+        }
+
+        if(!firstEvent) {
+            output.write(",");
+        }
+        output.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+        firstEvent = false;
+    }
+
+    events.clear();
+}
+
+void start(const QString &fileName)
+{
+    QMutexLocker lock(&mutex);
+
+    output.close();
+    output.setFileName(fileName);
+    if(!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return;
+    }
+
+    output.write("{\"traceEvents\":[");
+    firstEvent = true;
+    events.clear();
+    events.reserve(flushThreshold);
+    timer.start();
+    enabled = true;
+}
+
+void finish()
+{
+    if(!enabled.exchange(false)) {
+        return;
+    }
+
+    QMutexLocker lock(&mutex);
+
+    flush();
+    output.write("]}");
+    output.close();
+}
+
+bool isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+Scope::Scope(const char *name)
+{
+    if(isEnabled()) {
+        m_name = name;
+        m_begin = timer.nsecsElapsed();
+    }
+}
+
+Scope::Scope(const char *name, const QString &detail)
+{
+    if(isEnabled()) {
+        m_name = name;
+        m_detail = detail;
+        m_begin = timer.nsecsElapsed();
+    }
+}
+
+Scope::~Scope()
+{
+    if(m_begin < 0 || !isEnabled()) {
+        return;
+    }
+
+    const qint64 end {timer.nsecsElapsed()};
+    const int thread {threadIndex()};
+
+    QMutexLocker lock(&mutex);
+    if(!output.isOpen()) {
+        return; // finished meanwhile
+    }
+
+    events.push_back({m_name, std::move(m_detail), m_begin, end - m_begin, thread});
+    if(events.size() >= flushThreshold) {
+        flush();
+    }
+}
+
+} // namespace trace
+
+} // namespace cashbook
@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+namespace cashbook
+{
+
+/**
+ * @brief Scoped timers which are written as Chrome trace events.
+ * @details Tracing is off unless `start()` is called, then every `Scope`
+ *          records a complete event. Events are appended to the file in
+ *          Chrome trace-event JSON format, which `chrome://tracing` and
+ *          Perfetto open, in batches, so memory does not grow with session
+ *          length. `finish()` writes the rest and closes the file. Scopes nest
+ *          by time, so the viewer shows them as a hierarchy per thread.
+ *          Scopes may be used from any thread.
+ */
+namespace trace
+{
+
+void start(const QString &fileName);
+void finish();
+bool isEnabled();
+
+class Scope
+{
+public:
+    Scope() = default; // records nothing
+    explicit Scope(const char *name);
+    Scope(const char *name, const QString &detail);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *m_name {nullptr};
+    QString m_detail;
+    qint64 m_begin {-1};
+};
+
+} // namespace trace
+
+} // namespace cashbook
+
+#define CASHBOOK_TRACE_CONCAT_IMPL(a, b) a##b
+#define CASHBOOK_TRACE_CONCAT(a, b) CASHBOOK_TRACE_CONCAT_IMPL(a, b)
+
+/**
+ * Traces the rest of enclosing block. Optional second argument is shown
+ * as event's `detail` argument, e.g. a file name. Arguments are evaluated
+ * only if tracing is enabled.
+ */
+#define CASHBOOK_TRACE_SCOPE(...) \
+    const ::cashbook::trace::Scope CASHBOOK_TRACE_CONCAT(traceScope, __LINE__)( \
+        ::cashbook::trace::isEnabled() ? ::cashbook::trace::Scope(__VA_ARGS__) : ::cashbook::trace::Scope())
+
+#endif // TRACE_H
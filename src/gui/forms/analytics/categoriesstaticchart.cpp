@@ -54,33 +54,7 @@ void TreemapModel::updatePeriod()
         return;
     }
 
-    size_t i = 0;
-    while(i < log.size()) {
-        const Transaction &t = log[i++];
-        if(t.date > m_to) {
-            continue;
-        }
-
-        if(t.date < m_from) {
-            break;
-        }
-
-        if(t.type == Transaction::Type::Out) {
-            const ArchNode<Category> &archNode = t.category;
-            if(archNode.isValidPointer()) {
-                const Node<Category> *node = archNode.toPointer();
-                m_outCategoriesMap.propagateMoney(node, t.amount);
-            }
-        }
-
-        if(t.type == Transaction::Type::In) {
-            const ArchNode<Category> &archNode = t.category;
-            if(archNode.isValidPointer()) {
-                const Node<Category> *node = archNode.toPointer();
-                m_inCategoriesMap.propagateMoney(node, t.amount);
-            }
-        }
-    }
+    m_data->m_data.log.aggregateCategories(m_from, m_to, m_inCategoriesMap, m_outCategoriesMap);
 
     emit onUpdated();
 }
@@ -5,6 +5,7 @@
 #include "innodedialog.h"
 #include "bookkeeping/bookkeeping.h"
 #include "bookkeeping/serialization.h"
+#include "bookkeeping/trace.h"
 #include "selectwalletdialog.h"
 #include "walletpropertieswindow.h"
 #include "gui/forms/analytics/categoriesstaticchart.h"
@@ -44,6 +45,7 @@ static void extendColumn (View *view, int column, int pad) {
 
 template <class View>
 static void resizeContentsWithPadding(View *view, int columns, int pad) {
+    CASHBOOK_TRACE_SCOPE("resizeColumns", view->objectName());
     view->resizeColumnsToContents();
     for(int i = 0; i<columns; ++i) {
         extendColumn(view, i, pad);
@@ -52,6 +54,7 @@ static void resizeContentsWithPadding(View *view, int columns, int pad) {
 
 template <class View>
 static void resizeCellWithPadding(View *view, int column, int pad) {
+    CASHBOOK_TRACE_SCOPE("resizeColumns", view->objectName());
     view->resizeColumnToContents(column);
     extendColumn(view, column, pad);
 }
@@ -73,6 +76,14 @@ static void recalculateHeight(QTableView *view) {
     view->setFixedHeight(height);
 }
 
+static void setBriefSpans(QTableView *view) {
+    view->clearSpans();
+    for(int row = 0; row<view->model()->rowCount(); row += BriefRow::Count) {
+        view->setSpan(row + BriefRow::Received, BriefColumn::Date, 2, 1);
+        view->setSpan(row + BriefRow::Received, BriefColumn::Balance, 2, 1);
+    }
+}
+
 static void setSplitterStretching(QSplitter *splitter, int x1, int x2) {
     splitter->setStretchFactor(0, x1);
     splitter->setStretchFactor(1, x2);
@@ -116,10 +127,11 @@ static int callQuestionDialog(const QString &message, QWidget *parent)
     return msgBox.exec();
 }
 
-MainWindow::MainWindow(Data &data, QWidget *parent)
+MainWindow::MainWindow(Data &data, int recentMonths, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , m_data(data)
+    , m_recentMonths(recentMonths)
     , m_models(data)
     , m_modelsDelegate(m_models)
     , m_walletAnalytics(data, this)
@@ -139,6 +151,7 @@ MainWindow::~MainWindow()
 
 void MainWindow::preLoadSetup()
 {
+    CASHBOOK_TRACE_SCOPE("preLoadSetup");
     ui->setupUi(this);
 
     ui->menuLayout->setContentsMargins(0, 0, 0, 0);
@@ -264,11 +277,13 @@ void MainWindow::preLoadSetup()
 
 void MainWindow::loadData()
 {
-    cashbook::load(m_data);
+    CASHBOOK_TRACE_SCOPE("loadData");
+    cashbook::load(m_data, m_recentMonths);
 }
 
 void MainWindow::postLoadSetup()
 {
+    CASHBOOK_TRACE_SCOPE("postLoadSetup");
     m_models.logModel.update();
     emit m_models.walletsModel.recalculated();
 
@@ -289,10 +304,7 @@ void MainWindow::postLoadSetup()
     updateUnanchoredSum();
 
     ui->briefTable->setModel(&m_models.briefStatisticsModel);
-    for(int row = 0; row<ui->briefTable->model()->rowCount(); row += BriefRow::Count) {
-        ui->briefTable->setSpan(row + BriefRow::Received, BriefColumn::Date, 2, 1);
-        ui->briefTable->setSpan(row + BriefRow::Received, BriefColumn::Balance, 2, 1);
-    }
+    setBriefSpans(ui->briefTable);
 
     resizeContentsWithPadding(ui->briefTable, BriefColumn::Count, 30);
 
@@ -313,6 +325,31 @@ void MainWindow::postLoadSetup()
     m_allowAnalyticsUpdate = true;
     updateAnalytics();
 
+    // older months of the log may be still on disk, see `LogModel::fetchMore()`
+    connect(&m_models.logModel, &LogModel::historyFetched, this, [this]() {
+        m_data.updateTasks();
+        updateStatistics();
+        updateAnalytics();
+    });
+
+    // brief and tasks are kept up to date by log aggregates, views only need a redraw
+    connect(&m_models.logModel, &LogModel::dataChanged, this, &MainWindow::updateStatistics);
+    connect(&m_models.logModel, &LogModel::rowsInserted, this, &MainWindow::updateStatistics);
+    connect(&m_models.logModel, &LogModel::rowsRemoved, this, &MainWindow::updateStatistics);
+
+    QDate tasksFrom;
+    for(const auto *tasks : {&m_data.tasks.active.tasks, &m_data.tasks.completed.tasks}) {
+        for(const Task &task : *tasks) {
+            if(tasksFrom.isNull() || task.from < tasksFrom) {
+                tasksFrom = task.from;
+            }
+        }
+    }
+    if(tasksFrom.isValid()) {
+        m_models.logModel.fetchOlderAsync(tasksFrom);
+    }
+
+    CASHBOOK_TRACE_SCOPE("initTreemap");
     TreemapModel* p = new TreemapModel;
 
     ui->spentsDateFrom->setDate(QDate(Today.year(), Today.month(), 1));
@@ -323,11 +360,14 @@ void MainWindow::postLoadSetup()
 
     p->init(m_models);
 
-    connect(ui->spentsDateFrom, &QDateEdit::dateChanged, this, [p](const QDate &from) {
+    connect(ui->spentsDateFrom, &QDateEdit::dateChanged, this, [this, p](const QDate &from) {
         p->setDateFrom(from);
         p->updatePeriod();
+        m_models.logModel.fetchOlderAsync(from);
     });
 
+    connect(&m_models.logModel, &LogModel::historyFetched, p, &TreemapModel::updatePeriod);
+
     connect(ui->spentsDateTo, &QDateEdit::dateChanged, this, [p](const QDate &to) {
         p->setDateTo(to);
         p->updatePeriod();
@@ -371,6 +411,12 @@ void MainWindow::postLoadSetup()
 
 void MainWindow::saveData()
 {
+    CASHBOOK_TRACE_SCOPE("saveData");
+    // month which is still on disk can not be saved partially
+    if(!m_data.log.changedMonths.empty()) {
+        m_models.logModel.fetchOlder(m_data.log.changedMonths.begin()->toDate());
+    }
+
     cashbook::save(m_data);
     m_data.resetChanged();
 }
@@ -1136,6 +1182,14 @@ void cashbook::MainWindow::updateAnalytics()
     }
 }
 
+void cashbook::MainWindow::updateStatistics()
+{
+    m_models.tasksModels[TaskStatus::Active].update();
+    m_models.tasksModels[TaskStatus::Completed].update();
+    m_models.briefStatisticsModel.update();
+    setBriefSpans(ui->briefTable);
+}
+
 static QString getTextDialog(const QString &title, const QString &message, const QString &text, QWidget *parent)
 {
     bool ok = false;
@@ -1151,7 +1205,7 @@ void cashbook::MainWindow::on_actionEditNote_triggered()
 
     const Transaction &t = m_models.logModel.m_data.log[m_noteContextIndex.row()];
 
-    QString note = getTextDialog(tr("Примечание"), tr("Примечание"), t.note, this);
+    QString note = getTextDialog(tr("Примечание"), tr("Примечание"), t.note.get(), this);
     if(!note.isNull()) {
         m_models.logModel.updateNote(m_noteContextIndex.row(), note);
     }
@@ -47,7 +47,7 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit MainWindow(Data &data, QWidget *parent = 0);
+    explicit MainWindow(Data &data, int recentMonths = -1, QWidget *parent = 0);
     ~MainWindow();
 
 private slots:
@@ -147,6 +147,7 @@ private:
     void showCategoryContextMenu(const QPoint& point);
 
     void updateAnalytics();
+    void updateStatistics();
 
 protected:
     void closeEvent(QCloseEvent *event);
@@ -155,6 +156,7 @@ private:
     Ui::MainWindow *ui;
 
     Data &m_data;
+    int m_recentMonths {-1};
     DataModels m_models;
     ModelsDelegate m_modelsDelegate;
     ClickFilter m_clickFilter;
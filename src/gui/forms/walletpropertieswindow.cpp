@@ -179,6 +179,7 @@ void WalletPropertiesWindow::changeGuiByWalletType(int walletType)
 void WalletPropertiesWindow::fillWalletFromGui()
 {
     m_wallet.name = ui->nameEdit->text();
+    PathCache::invalidateAll();
     m_wallet.type = static_cast<Wallet::Type::t>(ui->typeCombo->currentIndex());
 
     const auto loadBank = [this](Wallet::AccountInfo* info)
@@ -33,6 +33,11 @@ void PopupTreeProxyModel::setFilterString(const QString& filterString) {
     m_timer.start(500);
 }
 
+void PopupTreeProxyModel::applyFilter() {
+    m_timer.stop();
+    _doFilterWork();
+}
+
 void PopupTreeProxyModel::_doFilterWork() {
     m_filtereItems.clear();
     m_mostMatched = QModelIndex();
@@ -111,6 +111,7 @@ public:
     PopupTreeProxyModel(QObject* parent = nullptr);
 
     void setFilterString(const QString& filterString);
+    void applyFilter(); // filters right away instead of waiting for typing to settle
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
 
 Q_SIGNALS:
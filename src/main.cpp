@@ -1,9 +1,13 @@
 #include "gui/forms/mainwindow.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
 #include <QStyleFactory>
 #include <QQuickWindow>
 
 #include "bookkeeping/bookkeeping.h"
+#include "bookkeeping/serialization.h"
+#include "bookkeeping/trace.h"
 
 int main(int argc, char *argv[])
 {
@@ -12,9 +16,61 @@ int main(int argc, char *argv[])
 
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+
+    QCommandLineOption recentMonthsOption(QStringLiteral("recent-months"),
+        QObject::tr("Загружать только <months> последних месяцев журнала, остальные подгружаются по мере необходимости."),
+        QStringLiteral("months"));
+    parser.addOption(recentMonthsOption);
+
+    QCommandLineOption traceOption(QStringLiteral("trace"),
+        QObject::tr("Записать трассировку загрузки и сохранения в <file> в формате Chrome trace. То же самое делает переменная окружения CASHBOOK_TRACE."),
+        QStringLiteral("file"));
+    parser.addOption(traceOption);
+
+    QCommandLineOption convertLogOption(QStringLiteral("convert-log"),
+        QObject::tr("Переписать все месяцы журнала в формате <format> и выйти: yaml — только файлы .pitm, segments — бинарные сегменты вместе с файлами .pitm. Формат запоминается для следующих сохранений."),
+        QStringLiteral("format"));
+    parser.addOption(convertLogOption);
+    parser.process(a);
+
+    QString traceFile = qEnvironmentVariable("CASHBOOK_TRACE");
+    if(parser.isSet(traceOption)) {
+        traceFile = parser.value(traceOption);
+    }
+    if(!traceFile.isEmpty()) {
+        cashbook::trace::start(traceFile);
+    }
+
+    if(parser.isSet(convertLogOption)) {
+        const QString format = parser.value(convertLogOption);
+        if(format != QStringLiteral("yaml") && format != QStringLiteral("segments")) {
+            qCritical().noquote() << QObject::tr("Неизвестный формат журнала: %1").arg(format);
+            return 1;
+        }
+
+        cashbook::Data data;
+        cashbook::convertLog(data, format == QStringLiteral("yaml") ? cashbook::LogFormat::Yaml : cashbook::LogFormat::Segments);
+        cashbook::trace::finish();
+        return 0;
+    }
+
+    int recentMonths = -1;
+    if(parser.isSet(recentMonthsOption)) {
+        bool ok = false;
+        const int months = parser.value(recentMonthsOption).toInt(&ok);
+        if(ok && months >= 0) {
+            recentMonths = months;
+        }
+    }
+
     cashbook::Data data;
-    cashbook::MainWindow w(data);
+    cashbook::MainWindow w(data, recentMonths);
     w.show();
 
-    return a.exec();
+    const int res = a.exec();
+    cashbook::trace::finish();
+
+    return res;
 }
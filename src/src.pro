@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT += core widgets gui charts qml quick quickwidgets
+QT += core concurrent widgets gui charts qml quick quickwidgets
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets webenginewidgets
 
 TARGET = cashbook
@@ -33,7 +33,11 @@ HEADERS += \
     bookkeeping/basic_types.h \
     bookkeeping/models.h \
     bookkeeping/bookkeeping.h \
+    bookkeeping/codecs.h \
+    bookkeeping/cache.h \
     bookkeeping/serialization.h \
+    bookkeeping/segment.h \
+    bookkeeping/trace.h \
     gui/forms/analytics/categoriesstaticchart.h \
     gui/forms/mainwindow.h \
     gui/forms/innodedialog.h \
@@ -48,7 +52,11 @@ SOURCES += \
     bookkeeping/basic_types.cpp \
     bookkeeping/models.cpp \
     bookkeeping/bookkeeping.cpp \
+    bookkeeping/codecs.cpp \
+    bookkeeping/cache.cpp \
     bookkeeping/serialization.cpp \
+    bookkeeping/segment.cpp \
+    bookkeeping/trace.cpp \
     gui/forms/analytics/categoriesstaticchart.cpp \
     gui/forms/mainwindow.cpp \
     gui/forms/innodedialog.cpp \